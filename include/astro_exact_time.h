@@ -0,0 +1,164 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ASTRO_EXACT_TIME_H
+#define ASTRO_EXACT_TIME_H
+
+#include <cstdint>
+
+#include <astro_julian_date.h>
+
+/**
+ * A fixed point epoch composed of an integer Modified Julian Day number
+ * and integer nanoseconds into that day.  Unlike the floating point
+ * JulianDate, stepping by a fixed duration any number of times introduces
+ * no error, and comparisons are exact.  Durations are integer nanoseconds.
+ * Conversion to the two part Julian Date form expected by SOFA places the
+ * whole day (ending in .5) in the high part, which is exactly
+ * representable, and the fraction of the day in the low part.
+ *
+ * Internally, 0 <= nanoseconds < NS_PER_DAY is always maintained.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class ExactTime {
+  public:
+    static constexpr std::int64_t NS_PER_SEC {1000000000LL};
+    static constexpr std::int64_t NS_PER_MIN {60LL*NS_PER_SEC};
+    static constexpr std::int64_t NS_PER_DAY {86400LL*NS_PER_SEC};
+      // Longest whole number of days spanned by an int64 nanosecond count
+    static constexpr std::int64_t MAX_DAYS {INT64_MAX/NS_PER_DAY};
+
+    /** Initialize with J2000 (MJD 51544, 12:00:00) */
+    ExactTime() {}
+
+    /**
+     * @param   mjd_day     Modified Julian Day number
+     * @param   ns_of_day   Nanoseconds from the start of mjd_day.  May be
+     *                      negative or exceed one day.
+     */
+    ExactTime(std::int64_t mjd_day, std::int64_t ns_of_day) :
+                                         day{mjd_day}, ns{ns_of_day}
+    {
+      normalize();
+    }
+
+    /**
+     * Convert from a floating point Julian Date, rounding to the nearest
+     * nanosecond.
+     *
+     * @param   jd   Julian Date
+     */
+    explicit ExactTime(const JulianDate& jd);
+
+    /**
+     * @param   days   Duration in days
+     *
+     * @return   Duration rounded to the nearest nanosecond
+     */
+    static std::int64_t ns_from_days(double days);
+
+    /**
+     * @param   minutes   Duration in minutes
+     *
+     * @return   Duration rounded to the nearest nanosecond
+     */
+    static std::int64_t ns_from_minutes(double minutes);
+
+    /** @return   Modified Julian Day number */
+    std::int64_t mjd_day() const { return day; }
+
+    /** @return   Nanoseconds into the day, 0 <= ns < NS_PER_DAY */
+    std::int64_t ns_of_day() const { return ns; }
+
+    /** @return   Whole day Julian Date (ending in .5), exact */
+    double jd_hi() const
+    {
+      return JulianDate::MJD + static_cast<double>(day);
+    }
+
+    /** @return   Fraction of the day, 0 <= jd_low < 1 */
+    double jd_low() const
+    {
+      return static_cast<double>(ns)/static_cast<double>(NS_PER_DAY);
+    }
+
+    /** @return   Modified Julian Date, scalar */
+    double mjd() const { return static_cast<double>(day) + jd_low(); }
+
+    /** @return   Two part JulianDate form of this epoch */
+    JulianDate to_jd() const { return JulianDate(jd_hi(), jd_low()); }
+
+    /**
+     * @param   dns   Nanoseconds to add (or subtract, if negative)
+     */
+    ExactTime& operator+=(std::int64_t dns)
+    {
+      ns += dns;
+      normalize();
+      return *this;
+    }
+
+    /**
+     * @param   dns   Nanoseconds to add (or subtract, if negative)
+     *
+     * @return   Copy of this epoch, adjusted by dns
+     */
+    ExactTime operator+(std::int64_t dns) const
+    {
+      ExactTime et {*this};
+      et += dns;
+      return et;
+    }
+
+    /**
+     * @return   Nanoseconds from et to this epoch.  Valid for separations
+     *           up to about 290 years.
+     */
+    std::int64_t operator-(const ExactTime& et) const
+    {
+      return (day - et.day)*NS_PER_DAY + (ns - et.ns);
+    }
+
+    bool operator==(const ExactTime& et) const
+    {
+      return day == et.day  &&  ns == et.ns;
+    }
+
+    bool operator!=(const ExactTime& et) const { return !(*this == et); }
+
+    bool operator<(const ExactTime& et) const
+    {
+      return day < et.day  ||  (day == et.day  &&  ns < et.ns);
+    }
+
+    bool operator>(const ExactTime& et) const { return et < *this; }
+
+    bool operator<=(const ExactTime& et) const { return !(et < *this); }
+
+    bool operator>=(const ExactTime& et) const { return !(*this < et); }
+
+  private:
+    std::int64_t day {51544};               // MJD
+    std::int64_t ns {NS_PER_DAY/2};         // Nanoseconds into day
+
+      // Carry whole days out of ns using floor division
+    void normalize()
+    {
+      std::int64_t carry = ns/NS_PER_DAY;
+      ns -= carry*NS_PER_DAY;
+      if (ns < 0) {
+        ns += NS_PER_DAY;
+        carry--;
+      }
+      day += carry;
+    }
+};
+
+#endif  // ASTRO_EXACT_TIME_H
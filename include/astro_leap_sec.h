@@ -9,16 +9,54 @@
 #ifndef ASTRO_LEAP_SEC_H
 #define ASTRO_LEAP_SEC_H
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
 
 /**
- * A class to handle retrieval of leapseconds
+ * A class to handle retrieval of leapseconds.  The table of leap seconds
+ * is either built in or loaded from a standard IERS/NIST leap-seconds.list
+ * or USNO tai-utc.dat file.  Tables are immutable once loaded and shared
+ * between copies.  Lookups use a binary search, optionally starting from
+ * a caller supplied cursor so sequential lookups are constant time.  Only
+ * the integer second era (1972 onward) is supported - TAI - UTC is zero
+ * before the first table entry.
  *
  * @author  Kurt Motekew
  * @date    20160314
  */
 class LeapSec {
   public:
+    /**
+     * Time span over which TAI - UTC is constant.
+     */
+    struct Segment {
+      std::size_t first;                    // Index of first grid point
+      std::size_t count;                    // Number of grid points
+      double taimutc;                       // TAI - UTC, seconds
+    };
+
+    /**
+     * Initialize with the built in table
+     */
+    LeapSec();
+
+    /**
+     * Initialize with a table loaded from a file.  The format (NTP
+     * leap-seconds.list or USNO tai-utc.dat) is detected from the contents.
+     *
+     * @param   filename   Leap second file
+     *
+     * @throws   invalid_argument if the file can't be read or contains no
+     *           leap seconds
+     */
+    explicit LeapSec(const std::string& filename);
+
     /**
      * @param   jd   The scalar form of a Julian Date for which to return
      *               the number of leap seconds.
@@ -34,6 +72,63 @@ class LeapSec {
      * @return   The number of leapseconds, TAI - UTC
      */
     double taiMutc(const JulianDate& jdc) const;
+
+    /**
+     * Lookup for times that are generally increasing.  The cursor is
+     * checked first, followed by the next table entry, before falling back
+     * to a binary search.
+     *
+     * @param   et       UTC time for which to return the leap seconds
+     * @param   cursor   Table location of the previous lookup.  Initialize
+     *                   to zero.  Updated with the location of this lookup.
+     *
+     * @return   The number of leapseconds, TAI - UTC
+     */
+    double taiMutc(const ExactTime& et, std::size_t& cursor) const;
+
+    /**
+     * Splits a uniform time grid into segments over which TAI - UTC is
+     * constant, allowing loops over the grid to perform a single lookup
+     * per segment.
+     *
+     * @param   start     UTC time of the first grid point
+     * @param   step_ns   Time between grid points, nanoseconds (positive)
+     * @param   count     Number of grid points
+     *
+     * @return   Consecutive segments covering all grid points, in order
+     */
+    std::vector<Segment> segments(const ExactTime& start,
+                                  std::int64_t step_ns,
+                                  std::size_t count) const;
+
+    /**
+     * Splits an increasing set of times into segments over which
+     * TAI - UTC is constant.
+     *
+     * @param   epoch     Time from which grid points are offset
+     * @param   offsets   Offsets of grid points from epoch, nanoseconds,
+     *                    in increasing order
+     * @param   count     Number of grid points
+     *
+     * @return   Consecutive segments covering all grid points, in order
+     */
+    std::vector<Segment> segments(const ExactTime& epoch,
+                                  const std::int64_t* offsets,
+                                  std::size_t count) const;
+
+    /** @return   Number of leap second table entries */
+    std::size_t size() const { return table->size(); }
+
+  private:
+    struct Entry {
+      std::int64_t mjd;                     // Effective at 00:00 UTC
+      double taimutc;                       // TAI - UTC from mjd onward
+    };
+
+    std::shared_ptr<const std::vector<Entry>> table;
+
+    std::size_t locate(std::int64_t mjd) const;
+    double value(std::size_t loc) const;
 };
 
 #endif  // ASTRO_LEAP_SEC_H
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef ASTRO_TABLE_CACHE_H
+#define ASTRO_TABLE_CACHE_H
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <astro_leap_sec.h>
+#include <astro_ut1mutc.h>
+
+/**
+ * Leap second and UT1 - UTC tables loaded from files, kept for reuse by
+ * any number of cases.  Each file is loaded on first request and handed
+ * out again for as long as it is unchanged, so cases naming the same
+ * file share one immutable table.  A file modified since it was loaded
+ * is loaded again.  Safe to use from multiple threads.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class AstroTableCache {
+  public:
+    /**
+     * @param   filename   Leap second file, see LeapSec(std::string)
+     *
+     * @return   Leap second table loaded from the file
+     *
+     * @throws   invalid_argument if the file can't be loaded
+     */
+    LeapSec leap_sec(const std::string& filename);
+
+    /**
+     * @param   filename   IERS EOP file, see UT1mUTC(std::string)
+     *
+     * @return   UT1 - UTC table loaded from the file
+     *
+     * @throws   invalid_argument if the file can't be loaded
+     */
+    UT1mUTC ut1_utc(const std::string& filename);
+
+    /** @return   Number of tables loaded, including reloads */
+    std::size_t loads() const;
+
+  private:
+      // Identifies the version of a file a table was loaded from
+    struct Stamp {
+      long long size {-1};
+      long long mtime_ns {-1};
+      bool operator==(const Stamp& other) const
+      {
+        return size == other.size  &&  mtime_ns == other.mtime_ns;
+      }
+    };
+
+    template <typename T>
+    struct Entry {
+      Stamp stamp;
+      T table;
+    };
+
+    mutable std::mutex mtx;
+    std::map<std::string, Entry<LeapSec>> leap_tables;
+    std::map<std::string, Entry<UT1mUTC>> eop_tables;
+    std::size_t nloads {0};
+
+    /**
+     * @param   filename   File to check
+     *
+     * @return   Current size and modification time, or defaults if the
+     *           file can't be found
+     */
+    static Stamp stamp(const std::string& filename);
+};
+
+#endif  // ASTRO_TABLE_CACHE_H
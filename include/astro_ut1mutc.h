@@ -9,16 +9,48 @@
 #ifndef ASTRO_UT1MUTC_H
 #define ASTRO_UT1MUTC_H
 
+#include <cstddef>
+#include <memory>
+#include <string>
+
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
 
 /**
- * A class to handle retrieval of UT1-UTC.
+ * A class to handle retrieval of UT1-UTC.  Values are linearly
+ * interpolated from daily IERS Earth Orientation Parameters, loaded from
+ * either a finals2000A (Bulletin A) or EOP C04 file.  The text file is
+ * parsed once and saved beside it as a compact binary table (filename
+ * with ".bin" appended) that later runs memory-map instead, as long as
+ * the text file is unchanged.  Tables are immutable and shared between
+ * copies.
+ *
+ * The one second steps in UT1-UTC at leap seconds are removed before
+ * interpolating within a day, so the day preceding a leap second is not
+ * smeared.  Values are held constant beyond the ends of the table.  With
+ * no table loaded, UT1-UTC is zero.
  *
  * @author  Kurt Motekew
  * @date    20160314
  */
 class UT1mUTC {
   public:
+    /**
+     * Initialize with no data - UT1-UTC is always zero
+     */
+    UT1mUTC() {}
+
+    /**
+     * Initialize with a table of daily values.  The format (finals2000A
+     * or EOP C04) is detected from the contents.
+     *
+     * @param   filename   IERS EOP file
+     *
+     * @throws   invalid_argument if the file can't be read or contains no
+     *           UT1-UTC values
+     */
+    explicit UT1mUTC(const std::string& filename);
+
     /**
      * @param   jd   The scalar form of a Julian Date for which to return
      *               the difference between UTC and UT1
@@ -34,6 +66,37 @@ class UT1mUTC {
      * @return   UT1 - UTC, seconds
      */
     double ut1Mutc(const JulianDate& jdc) const;
+
+    /**
+     * Lookup for times that are generally increasing.  The interval
+     * located by the previous lookup is checked first, followed by the
+     * next one, before falling back to a binary search.
+     *
+     * @param   et       UTC time for which to return UT1 - UTC
+     * @param   cursor   Table location of the previous lookup.  Initialize
+     *                   to zero.  Updated with the location of this lookup.
+     *
+     * @return   UT1 - UTC, seconds
+     */
+    double ut1Mutc(const ExactTime& et, std::size_t& cursor) const;
+
+    /** @return   Number of daily values loaded */
+    std::size_t size() const { return nnodes; }
+
+  private:
+    struct Node {
+      double mjd;                           // UTC, 0h
+      double ut1mutc;                       // UT1 - UTC, seconds
+    };
+
+    std::shared_ptr<const void> data;       // Owns nodes (heap or mapping)
+    const Node* nodes {nullptr};
+    std::size_t nnodes {0};
+
+    bool map_cache(const std::string& cache_name,
+                   long long src_size, long long src_mtime);
+    std::size_t locate(double mjd) const;
+    double interpolate(std::size_t loc, double mjd) const;
 };
 
 #endif  // ASTRO_UT1MUTC_H
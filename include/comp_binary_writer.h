@@ -0,0 +1,178 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMP_BINARY_WRITER_H
+#define COMP_BINARY_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <comp_series.h>
+#include <astro_exact_time.h>
+#include <comp_time_axis.h>
+#include <utl_gorilla.h>
+
+class CompIFunction;
+
+/**
+ * Writes function results in a binary columnar layout.  Uncompressed
+ * files may be memory mapped and used in place, with no parsing.
+ * Compressed files store each column as independently decodable blocks
+ * so any range of records may be read without decoding the whole file.
+ * All fields are little endian.  Each column starts on a 64 byte
+ * boundary.
+ * <P>
+ * Header, at the start of the file:
+ * <pre>
+ *   0  char[8]  "VMSATCOL"
+ *   8  u32      Format version (2)
+ *  12  u32      Header size, bytes - offset of the first column
+ *  16  u64      Number of records, N
+ *  24  u32      Values per record (number of value columns), W
+ *  28  u32      Number of unit bands, B
+ *  32  u32      Time axis kind:  1 = uniform, 0 = explicit
+ *  36  u32      Column codec:  0 = raw, 1 = compressed
+ *  40  i64      Epoch, Modified Julian Day number (UTC)
+ *  48  i64      Epoch, nanoseconds into the day
+ *  56  i64      Uniform axis step, nanoseconds (0 if explicit)
+ *  64  u64      Offset of the i64 record time column, nanoseconds from
+ *               the epoch (0 if the axis is uniform)
+ *  72  u64      Offset of the first f64 value column
+ *  80  u64      Column stride, bytes - value column c starts at
+ *               (first value column offset) + c*stride
+ *  88  u32      Length of function type name, T
+ *  92  u32      Length of function label, L
+ *  96  char[T]  Function type name, then char[L] label
+ * </pre>
+ * followed by B band descriptors:
+ * <pre>
+ *      i32      First value column of the band
+ *      i32      Number of value columns in the band
+ *      f64      Scale factor from stored values to the band units
+ *      u32      Length of units label, U
+ *      char[U]  Units label
+ * </pre>
+ * Values are stored in internal units - multiply by the band factor to
+ * obtain values in the labeled units.  Strings are not null terminated.
+ * <P>
+ * With the compressed codec, the time and value column offsets locate
+ * 32 byte column descriptors rather than the data itself, with the
+ * stride being the descriptor size:
+ * <pre>
+ *      u64      Offset of the encoded column data
+ *      u64      Size of the encoded column data, bytes
+ *      u32      Records per block
+ *      u32      Number of blocks, K
+ *      u64      Offset of a table of K u64 block starts, in bytes from
+ *               the start of the encoded column data
+ * </pre>
+ * Times are encoded by DodColumn and values by GorillaColumn.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompBinaryWriter {
+  public:
+    /** Format version written to the header */
+    static constexpr std::uint32_t VERSION {2};
+
+    /** Alignment of the header size and each column, bytes */
+    static constexpr std::size_t ALIGN {64};
+
+    /**
+     * Creates the file.  Uncompressed files are sized for all records
+     * and the header written immediately.  Compressed files are written
+     * when closed.  Check is_open() for success.
+     *
+     * @param   filename   File to create or truncate
+     * @param   fn         Function providing type, label, and units
+     * @param   axis       Times of all records to be written
+     * @param   width      Values per record
+     * @param   view       Any view of the series to be written, used for
+     *                     the unit band layout
+     * @param   compress   If true, use the compressed codec
+     */
+    CompBinaryWriter(const std::string& filename, const CompIFunction& fn,
+                     const CompTimeAxis& axis, int width,
+                     const CompSeriesView& view, bool compress = false);
+
+    /**
+     * Writes the same layout into memory rather than a file.
+     *
+     * @param   dest       Receives the file contents, replacing anything
+     *                     held.  Must outlive the writer.
+     * @param   fn         See above
+     * @param   axis       See above
+     * @param   width      See above
+     * @param   view       See above
+     * @param   compress   See above
+     */
+    CompBinaryWriter(std::string* dest, const CompIFunction& fn,
+                     const CompTimeAxis& axis, int width,
+                     const CompSeriesView& view, bool compress = false);
+
+    CompBinaryWriter(const CompBinaryWriter&) = delete;
+    CompBinaryWriter& operator=(const CompBinaryWriter&) = delete;
+
+    ~CompBinaryWriter() { close(); }
+
+    /** @return   True if the file was created, or writing to memory */
+    bool is_open() const { return fd >= 0  ||  mem != nullptr; }
+
+    /**
+     * Writes a batch of records in place.  Uncompressed batches may be
+     * written in any order.  Compressed batches are encoded as written
+     * and must be written in time order.
+     *
+     * @param   view   Records to write, located within the axis by
+     *                 view.first()
+     *
+     * @throws   logic_error if a compressed batch is out of order
+     */
+    void write(const CompSeriesView& view);
+
+    /**
+     * Completes and closes the file.
+     */
+    void close();
+
+  private:
+    int fd {-1};
+    std::string* mem {nullptr};             // Destination if not a file
+    std::size_t nrec {0};
+    int ncol {0};
+    ExactTime et0;
+    bool uniform {true};
+    std::uint64_t toff_pos {0};
+    std::uint64_t val_pos {0};
+    std::uint64_t stride {0};
+      // Compressed codec, columns encoded until the file is closed
+    bool packed {false};
+    std::vector<unsigned char> hdr;
+    std::unique_ptr<DodColumn> tcol;
+    std::vector<GorillaColumn> vcols;
+    std::size_t nenc {0};
+
+    CompBinaryWriter(const CompIFunction& fn, const CompTimeAxis& axis,
+                     int width, const CompSeriesView& view, bool compress);
+    void start();
+    void finish_packed();
+    std::uint64_t write_column(const std::vector<std::uint8_t>& data,
+                               const std::vector<std::uint64_t>& blocks,
+                               std::size_t block_size,
+                               std::uint64_t pos, std::uint64_t dir_pos);
+    void pwrite_all(const void* data, std::size_t n, std::uint64_t pos);
+    void write_le(const std::int64_t* vals, std::size_t n,
+                                            std::uint64_t pos);
+    void write_le(const double* vals, std::size_t n, std::uint64_t pos);
+};
+
+#endif  // COMP_BINARY_WRITER_H
@@ -9,7 +9,9 @@
 #ifndef COMP_EARTH_ROT_H
 #define COMP_EARTH_ROT_H
 
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <iostream>
 #include <map>
 #include <vector>
@@ -19,9 +21,10 @@
 #include <comp_ifunction.h>
 #include <comp_irecord.h>
 #include <comp_scalar.h>
+#include <comp_series.h>
+#include <comp_time_grid.h>
+#include <utl_thread_pool.h>
 #include <astro_julian_date.h>
-#include <astro_leap_sec.h>
-#include <astro_ut1mutc.h>
 
 /**
  * Earth rotation types
@@ -58,38 +61,122 @@ class CompEarthRot : public CompIFunction {
      *                        [1] = An EarthRotType string
      *                        [2] = Output rate
      *                        [3] = Optional label/filename
+     * @param   mr            Source of storage for results.  Must outlive
+     *                        this function.
      *
      * @throws   invalid_argument if there is an error parsing the inputs
      */
-    CompEarthRot(const std::vector<std::string>& funct_params);
+    CompEarthRot(const std::vector<std::string>& funct_params,
+                 std::pmr::memory_resource* mr =
+                                         std::pmr::get_default_resource());
 
     /**
-     * Process analysis request using case definition values
+     * Process analysis request using case definition values.  Long time
+     * spans are split into chunks computed concurrently using the
+     * simulation's thread pool.  Results are identical to those computed
+     * serially.
      *
      * @param   cs   Calling simulation with general scenario information
      */
     virtual void execute(const CompISimulation& cs);
 
     /**
-     * Create report of computed results consisting of formatted output
-     * and/or a .csv file.
+     * @return   Output rate, nanoseconds
+     */
+    virtual std::int64_t grid_step() const;
+
+    /**
+     * @return   Output rate, minutes
+     */
+    virtual double output_rate() const { return dt_min; }
+
+    /**
+     * @param   minutes   Output rate replacing the one given when defined
+     *
+     * @throws   invalid_argument if the rate is not positive
+     */
+    virtual void output_rate(double minutes);
+
+    /**
+     * @return   True - earth rotation may be computed in chunks
+     */
+    virtual bool streams() const { return true; }
+
+    /**
+     * Sets up the output time axis without computing any records.
+     *
+     * @param   cs   Calling simulation with general scenario information
      *
-     * @param   out   Stream for standard formatted output, if enabled.
+     * @return   Number of records to be computed
+     */
+    virtual std::size_t stream_begin(const CompISimulation& cs);
+
+    /**
+     * Computes a chunk of records using a time grid spanning only the
+     * chunk.  Results are identical to those from execute().
+     *
+     * @param   cs      Calling simulation
+     * @param   first   Zero based index of the first record
+     * @param   count   Maximum number of records
+     * @param   in      Unused - no inputs
+     * @param   out     Receives the chunk of records
+     */
+    virtual void stream_chunk(const CompISimulation& cs, std::size_t first,
+                              std::size_t count,
+                              const std::vector<CompSeriesView>& in,
+                              CompSeries& out) const;
+
+    /**
+     * @return   Earth rotation type, leading each record of formatted
+     *           output
+     */
+    virtual std::string report_prefix() const;
+
+    /**
+     * @return   View of computed results
+     */
+    virtual CompSeriesView results() const { return cmp_lst.view(); }
+
+    /**
+     * Compresses saved outputs, see CompIFunction::pack_results()
+     */
+    virtual void pack_results() { cmp_lst.pack(); }
+
+    /**
+     * Restores saved outputs
      */
-    virtual void report(std::ostream& out) const;
+    virtual void unpack_results() { cmp_lst.unpack(); }
 
     /**
-     * Retrieve a record of computed data given an index number.
-     * Index limit available through super class.
+     * Frees saved outputs
      */
-    virtual std::unique_ptr<CompIRecord> record(unsigned int ndx) const;
+    virtual void release_results() { cmp_lst.clear(); }
 
   private:
-    LeapSec delta_at;
-    UT1mUTC delta_ut;
+      // Minimum number of output points per concurrently computed chunk
+    static constexpr std::size_t MIN_CHUNK {4096};
+
     EarthRotType er_type;
     double dt_min {1.0};
-    std::vector<CompScalar> cmp_lst;             // Saved outputs
+    CompSeries cmp_lst;                          // Saved outputs
+
+    /**
+     * @param   grid   Time grid with UT1 and TT epochs
+     * @param   ndx    Grid point at which to compute earth rotation
+     *
+     * @return   Earth rotation value for this function type
+     */
+    double gmst(const CompTimeGrid& grid, std::size_t ndx) const;
+
+    /**
+     * Sets each held output record from the corresponding grid point.
+     *
+     * @param   grid   Time grid aligned with the held records
+     * @param   pool   If not null, used to fill chunks concurrently
+     * @param   cs     Output records to set
+     */
+    void fill(const CompTimeGrid& grid, ThreadPool* pool,
+                                        CompSeries& cs) const;
 };
 
 
@@ -9,15 +9,23 @@
 #ifndef COMP_FUNCTION_H
 #define COMP_FUNCTION_H
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
 #include <ostream>
-#include <array>
 #include <map>
 #include <vector>
 #include <string>
 
 #include <comp_isimulation.h>
 #include <comp_irecord.h>
+#include <comp_series.h>
+#include <comp_time_axis.h>
+#include <comp_label_registry.h>
+#include <astro_exact_time.h>
+#include <utl_io_stage.h>
+
+class CompReportSink;
 
 /**
  * Keywords associated with functions to be executed using case file objects
@@ -60,6 +68,9 @@ class CompIFunction {
     /** @return   The type of function */
     CompType ftype() const { return comp_type; }
 
+    /** @return   Name of the function type, as used in a case file */
+    std::string type_name() const;
+
     /**
      * Process analysis request using case definition values
      *
@@ -68,11 +79,101 @@ class CompIFunction {
     virtual void execute(const CompISimulation& cs) = 0;
 
     /**
-     * Report analysis results
+     * @return   Step of the uniform time grid requested from the
+     *           simulation when executed (see
+     *           CompISimulation::timeGrid()), nanoseconds, or zero if
+     *           none.  Lets the simulation free shared grids once no
+     *           function still to be executed needs them.
+     */
+    virtual std::int64_t grid_step() const { return 0; }
+
+    /**
+     * @return   True if this function can be executed a chunk of records
+     *           at a time through stream_begin() and stream_chunk()
+     */
+    virtual bool streams() const { return false; }
+
+    /**
+     * Prepares to execute in chunks.  No records are computed - results()
+     * remains empty while streaming.  Inputs must have been prepared
+     * first.
+     *
+     * @param   cs   Reference to simulation calling this function
+     *
+     * @return   Total number of records to be computed, also available
+     *           through num_records()
+     *
+     * @throws   logic_error if streams() is false
+     */
+    virtual std::size_t stream_begin(const CompISimulation& cs);
+
+    /**
+     * Computes a chunk of records into a separate container, so chunks
+     * may be handed on to consumers while the next is computed, and
+     * freed once consumed.  Distinct chunks may be computed concurrently
+     * with the chunks of other functions.
+     *
+     * @param   cs      Reference to simulation calling this function
+     * @param   first   Zero based index of the first record
+     * @param   count   Number of records, reduced if extending past the
+     *                  last record
+     * @param   in      The same chunk of each input, in the order of
+     *                  inputs()
+     * @param   out     Initialized by this function with a window of
+     *                  the computed records (see CompSeries::window())
+     *
+     * @throws   logic_error if streams() is false
+     */
+    virtual void stream_chunk(const CompISimulation& cs, std::size_t first,
+                              std::size_t count,
+                              const std::vector<CompSeriesView>& in,
+                              CompSeries& out) const;
+
+    /**
+     * Report analysis results.  The default sends report_header() to the
+     * output stream and then makes a single pass over results(), writing
+     * each record to all destinations enabled by the report options (see
+     * CompReportSink).
+     *
+     * @param   out   Output stream for formatted output
+     * @param   io    If not null, all output is written by this stage's
+     *                thread, in order, while the caller moves on to
+     *                formatting more output.
+     */
+    virtual void report(std::ostream& out, IoStage* io) const;
+
+    /**
+     * Report analysis results, writing directly from the calling thread.
+     *
+     * @param   out   Output stream for formatted output
+     */
+    void report(std::ostream& out) const { report(out, nullptr); }
+
+    /**
+     * Opens the report destinations and writes report_header(), leaving
+     * records to be written a batch at a time, in order, through the
+     * returned sink.
+     *
+     * @param   out   Output stream for formatted output
+     * @param   io    If not null, performs writes in the background
+     *
+     * @return   Sink for records of this function
+     */
+    std::unique_ptr<CompReportSink> report_begin(std::ostream& out,
+                                                 IoStage* io) const;
+
+    /**
+     * @return   Text leading each record of readable report output
+     */
+    virtual std::string report_prefix() const { return " "; }
+
+    /**
+     * Summary written to the output stream ahead of any records, whether
+     * or not records are sent to the stream.  None by default.
      *
      * @param   out   Output stream for formatted output
      */
-    virtual void report(std::ostream& out) const = 0;
+    virtual void report_header(std::ostream& out) const {}
 
     /**
      * @return   Label attached to this instance of this function. This
@@ -90,6 +191,49 @@ class CompIFunction {
      */
     bool report_label() const { return do_label; }
 
+    /**
+     * @return   Base name of files written by the report - the label
+     *           followed by any suffix set with file_suffix()
+     */
+    std::string file_name() const { return fnct_label + file_sfx; }
+
+    /**
+     * @param   sfx   Appended to the label to name files written by the
+     *                report, keeping apart the files of functions that
+     *                are otherwise identical
+     */
+    void file_suffix(const std::string& sfx) { file_sfx = sfx; }
+
+    /**
+     * @return   Destination of binary output in place of a file, or null
+     *           if written to a file
+     */
+    std::string* binary_buffer() const { return bin_buf; }
+
+    /**
+     * @param   buf   If not null, binary output is written here rather
+     *                than to a file (see CompBinaryWriter).  Must outlive
+     *                any report of this function.
+     */
+    void binary_buffer(std::string* buf) { bin_buf = buf; }
+
+    /**
+     * @return   Output rate, minutes, or zero if the function has no
+     *           rate that may be changed through output_rate(double)
+     */
+    virtual double output_rate() const { return 0.0; }
+
+    /**
+     * Changes the output rate chosen when the function was defined.  Must
+     * be called before the function is executed.
+     *
+     * @param   minutes   New output rate
+     *
+     * @throws   invalid_argument if the rate is not positive or the
+     *           function has no output rate
+     */
+    virtual void output_rate(double minutes);
+
     /**
      * Each record is a time stamped set of data computed by this function.
      *
@@ -98,9 +242,45 @@ class CompIFunction {
     unsigned int num_records() const { return nrec; }
 
     /**
-     * Interface to return a record given the index number.  
+     * Read only access to computed results.  Times and values are exposed
+     * as contiguous arrays that may be walked whole or in chunks without
+     * allocating or dispatching per record.  The view remains valid until
+     * this function is executed again.
+     *
+     * @return   View of all records computed by this function
+     */
+    virtual CompSeriesView results() const = 0;
+
+    /**
+     * Compresses stored results to reduce the memory they hold once no
+     * longer needed for computation or reporting.  results() must not be
+     * called until unpack_results() restores them.  Functions without
+     * stored results ignore this.
+     */
+    virtual void pack_results() {}
+
+    /**
+     * Restores results compressed by pack_results().
+     */
+    virtual void unpack_results() {}
+
+    /**
+     * Frees stored results once no longer needed by consumers or
+     * reports.  results() is then empty, although num_records() is
+     * unchanged.  Functions without stored results ignore this.
+     */
+    virtual void release_results() {}
+
+    /**
+     * Returns a copy of a single value record given the index number.
+     * Retained for compatibility - prefer results() for bulk access.
+     *
+     * @param   ndx   Zero based record index, less than num_records()
+     *
+     * @throws   out_of_range if the record is not held, as once results
+     *           have been released
      */
-    virtual std::unique_ptr<CompIRecord> record(unsigned int ndx) const = 0;
+    std::unique_ptr<CompIRecord> record(unsigned int ndx) const;
 
     /**
      * Indicates the number of sets of units in a given record of data.
@@ -138,22 +318,17 @@ class CompIFunction {
      */
     std::string unit_labels(int ndx) const { return ulabels[ndx]; }
 
-
-  protected:
     /**
-     * Utility function to parse the function label.  If only a function
-     * label is supplied, assume this is the filename for output and turn
-     * off all other modifiers.  The format for a label is "FL*:label" where
-     * the ':' is a separator, 'F' indicates this is a filename, 'L' indicates
-     * this is a label, and '*' indicates formatted output should still be
-     * sent through the default stream.  All or none may be applied.  Note
-     * that "F:label" is redundant.
+     * Functions that consume the results of other functions must not
+     * be executed until those inputs are complete.  Input locations are
+     * resolved from labels when the function is created, forming the
+     * dependency graph used to schedule execution.
      *
-     * @param   String containing function label and labeling options.
-     *
-     * @throws   invalid_argument
+     * @return   Zero based locations, within the list of functions
+     *           supplied during construction, of functions this one
+     *           depends on.  Empty if there are no dependencies.
      */
-    void report_options(const std::string& report_str);
+    const std::vector<int>& inputs() const { return input_locs; }
 
     /**
      * @return   If true, outputs are to be sent to the requested output
@@ -166,30 +341,70 @@ class CompIFunction {
      */
     bool report_file() const { return do_file; }
 
+    /**
+     * @return   If true, outputs are to be sent to a binary columnar file
+     *           (see CompBinaryWriter)
+     */
+    bool report_binary() const { return do_binary; }
+
+    /**
+     * @return   If true, records are written by report() to at least one
+     *           destination.  Otherwise only a header, if any, is written
+     *           and results are of use only as input to other functions.
+     */
+    bool report_records() const
+    {
+      return do_ostream  ||  do_file  ||  do_binary;
+    }
+
+    /**
+     * @return   If true, binary output is written compressed (see
+     *           CompBinaryWriter).  Defaults to true.
+     */
+    bool compression() const { return do_compress; }
+
+    /**
+     * @param   on   Enables or disables compression, see compression()
+     */
+    void compression(bool on) { do_compress = on; }
+
+
+  protected:
+    /**
+     * Utility function to parse the function label.  If only a function
+     * label is supplied, assume this is the filename for output and turn
+     * off all other modifiers.  The format for a label is "FBL*:label" where
+     * the ':' is a separator, 'F' indicates this is a filename, 'B' indicates
+     * this is the name of a binary output file (label.bin), 'L' indicates
+     * this is a label, and '*' indicates formatted output should still be
+     * sent through the default stream.  All or none may be applied.  Note
+     * that "F:label" is redundant.
+     *
+     * @param   String containing function label and labeling options.
+     *
+     * @throws   invalid_argument
+     */
+    void report_options(const std::string& report_str);
+
     /**
      * @param   Sets the number of records.
      */
     void num_rec(unsigned int nr) { nrec = nr; }
 
     /**
-     * @param   lbl1   Name of first function to find in comps list
-     * @param   lbl2   Name of second function to find in comps list
-     * @param   comps  List to search for comps with lbl1 and lbl2 names
+     * Locates the labeled functions providing input to this one and
+     * records each as a dependency, see add_input().  Any number of
+     * inputs may be given, each from a different function.
      *
-     * @return   Locations in comps.  Negative values indicate label not
-     *           found.
+     * @param   lbls       Labels of input functions, in input order
+     * @param   registry   Labels of the functions defined so far
+     *
+     * @return   False if any label was not found or more than one label
+     *           locates the same function, in which case no inputs are
+     *           added
      */
-    std::array<int, 2> find_comp_locs(
-                     const std::string& lbl1, const  std::string& lbl2,
-                     const std::vector<std::unique_ptr<CompIFunction>> &comps);
-/*
-    {
-       std::array<int, 2> vals {{ -1, -1}};
-       vals[0] = 7;
-       vals[1] = 5;
-       return vals;
-    }
-*/
+    bool add_inputs(const std::vector<std::string>& lbls,
+                    const CompLabelRegistry& registry);
 
     /**
      * Adds a set of units to this functions outputs.  See num_unit_types(),
@@ -203,18 +418,79 @@ class CompIFunction {
      */
     void add_unit_type(std::string lbl, double factor, int offset);
 
+    /**
+     * Records a dependency on the results of another function.  See
+     * inputs().
+     *
+     * @param   loc   Location of the function providing input
+     */
+    void add_input(int loc) { input_locs.push_back(loc); }
+
+    /**
+     * Prepares a result container for records produced by this function,
+     * with unit bands matching those added through add_unit_type().
+     *
+     * @param   cs      Container to initialize
+     * @param   epoch   Reference time for record times
+     * @param   width   Number of values per record
+     */
+    void init_series(CompSeries& cs, const ExactTime& epoch,
+                                     int width) const
+    {
+      cs.reset(epoch, width, ubands);
+    }
+
+    /**
+     * Prepares a result container for records produced by this function
+     * at the times given by an existing time axis.
+     *
+     * @param   cs      Container to initialize
+     * @param   axis    Times of records
+     * @param   width   Number of values per record
+     */
+    void init_series(CompSeries& cs,
+                     const std::shared_ptr<const CompTimeAxis>& axis,
+                     int width) const
+    {
+      cs.reset(axis, width, ubands);
+    }
+
+    /**
+     * Prepares a result container holding a window of the records
+     * produced by this function at the times given by an existing time
+     * axis (see CompSeries::window()).
+     *
+     * @param   cs      Container to initialize
+     * @param   axis    Times of all records
+     * @param   width   Number of values per record
+     * @param   first   Index within the axis of the first record held
+     * @param   count   Number of records held
+     */
+    void init_series(CompSeries& cs,
+                     const std::shared_ptr<const CompTimeAxis>& axis,
+                     int width, std::size_t first, std::size_t count) const
+    {
+      cs.reset(axis, width, ubands, first, count);
+    }
+
   private:
     unsigned int nrec {0};                  // Number of records of data
     CompType comp_type {CompType::NONE};    // Function type
     std::string fnct_label {""};            // Internal name and/or filename
+    std::string file_sfx {""};              // Appended to output filenames
+    std::string* bin_buf {nullptr};         // Binary output, if not a file
     bool do_ostream {true};                 // Standard formatted output
     bool do_file {false};                   // .csv file
+    bool do_binary {false};                 // Binary columnar file
     bool do_label {false};                  // Labeled function (handle)
+    bool do_compress {true};                // Compressed results/binary
       // Units tracking for outputs
     int nunits {0};                         // Number of unit types in record
     std::vector<int> ubands;                // Offset for each unit type
     std::vector<double> ufactors;           // Conversion from comp units
     std::vector<std::string> ulabels;       // Labels for converted units
+      // Dependencies on other functions
+    std::vector<int> input_locs;
 };
 
 
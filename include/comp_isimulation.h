@@ -9,7 +9,16 @@
 #ifndef COMP_ISIMULATION_H
 #define COMP_ISIMULATION_H
 
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
+#include <astro_leap_sec.h>
+#include <astro_ut1mutc.h>
+#include <comp_time_grid.h>
+#include <utl_thread_pool.h>
 
 /**
  * Interface defining methods associated with a simulation or a subset
@@ -29,6 +38,34 @@ class CompISimulation {
 
     /** @return  Simulation period in days */
     virtual double simDays() const = 0;
+
+    /**
+     * @return  Worker threads available to functions for splitting up
+     *          their own computations.  May be null, in which case
+     *          functions should run serially.
+     */
+    virtual ThreadPool* threadPool() const = 0;
+
+    /** @return  Leap second table to use for UTC based conversions */
+    virtual const LeapSec& leapSec() const = 0;
+
+    /** @return  UT1 - UTC table to use for UT1 based conversions */
+    virtual const UT1mUTC& ut1mUtc() const = 0;
+
+    /**
+     * Time grids are shared - functions requesting the same grid receive
+     * the same precomputed time scale conversions.
+     *
+     * @param   start     UTC time of the first grid point
+     * @param   step_ns   Time between grid points, nanoseconds (positive)
+     * @param   count     Number of grid points
+     *
+     * @return  Uniform time grid with UTC, TAI, TT, and UT1 epochs
+     */
+    virtual std::shared_ptr<const CompTimeGrid>
+                                timeGrid(const ExactTime& start,
+                                         std::int64_t step_ns,
+                                         std::size_t count) const = 0;
 };
 
 
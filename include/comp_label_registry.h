@@ -0,0 +1,89 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMP_LABEL_REGISTRY_H
+#define COMP_LABEL_REGISTRY_H
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Hash indexed table of the labels of functions whose results are
+ * available as inputs to other functions.  Each distinct label is
+ * interned once and identified by a handle that remains valid, and
+ * refers to the same label, for the life of the registry.  Handles are
+ * bound to the location of the function defining the label, so inputs
+ * are resolved with a single lookup per label rather than a search of
+ * all functions.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompLabelRegistry {
+  public:
+    /** Interned label identifier */
+    typedef std::size_t Handle;
+
+    /** Location of a label not bound to any function */
+    static constexpr int NOT_FOUND {-1};
+
+    /**
+     * @param   label   Label to intern
+     *
+     * @return   Handle for the label, the same for every call with equal
+     *           text
+     */
+    Handle intern(std::string_view label);
+
+    /**
+     * Binds a label to the function defining it.  The first function
+     * defined with a label keeps it.
+     *
+     * @param   label   Function label
+     * @param   loc     Zero based location of the function
+     *
+     * @return   False if the label was already bound, in which case the
+     *           existing binding is retained
+     */
+    bool bind(std::string_view label, int loc);
+
+    /**
+     * @param   label   Function label
+     *
+     * @return   Location of the function defining the label, or NOT_FOUND
+     */
+    int location(std::string_view label) const;
+
+    /**
+     * @param   handle   Interned label
+     *
+     * @return   Location of the function defining the label, or NOT_FOUND
+     */
+    int location(Handle handle) const { return locs[handle]; }
+
+    /**
+     * @param   handle   Interned label
+     *
+     * @return   Text of the label
+     */
+    const std::string& name(Handle handle) const { return names[handle]; }
+
+    /** @return   Number of distinct labels interned */
+    std::size_t size() const { return names.size(); }
+
+  private:
+    std::deque<std::string> names;          // Stable storage for keys
+    std::vector<int> locs;                  // Per handle
+    std::unordered_map<std::string_view, Handle> index;
+};
+
+#endif  // COMP_LABEL_REGISTRY_H
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMP_REPORT_SINK_H
+#define COMP_REPORT_SINK_H
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <comp_series.h>
+#include <comp_binary_writer.h>
+#include <utl_buffered_writer.h>
+#include <utl_io_stage.h>
+#include <utl_greg_formatter.h>
+
+class CompIFunction;
+
+/**
+ * Output destinations for the records of a function, selected by the
+ * function's report options.  Each batch of records is walked once, with
+ * every record sent to all enabled destinations:
+ * <P>
+ * Readable text to the report stream, one record per line:
+ *   "\n<prefix><values> <units>[, <values> <units>...] at <date/time>"
+ * with values in fixed notation.
+ * <P>
+ * A .csv file named after the function label, one record per line:
+ *   "<MJD>,<value>[,<value>...]"
+ * with the shortest text that reads back as the same value.
+ * <P>
+ * A binary columnar file named after the function label with a .bin
+ * extension (see CompBinaryWriter), compressed if the function's
+ * compression() is enabled.  The function's binary_buffer(), if set,
+ * receives the file contents instead.
+ * <P>
+ * Values are scaled by the function's unit factors.  Output is buffered
+ * and is complete once close() is called or the sink is destroyed.  Given
+ * an IoStage, all writes, including any header, are performed by the
+ * stage's thread in the order written.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompReportSink {
+  public:
+    /** Digits after the decimal point in readable text values */
+    static constexpr int TEXT_PRECISION {13};
+
+    /**
+     * @param   fn    Function whose records are to be reported.  Must
+     *                outlive the sink.
+     * @param   out   Stream for readable text
+     * @param   io    If not null, performs writes in the background.
+     *                Must outlive the sink.
+     */
+    CompReportSink(const CompIFunction& fn, std::ostream& out,
+                                            IoStage* io = nullptr);
+
+    CompReportSink(const CompReportSink&) = delete;
+    CompReportSink& operator=(const CompReportSink&) = delete;
+
+    ~CompReportSink() { close(); }
+
+    /**
+     * Sends text to the readable text stream whether or not records are
+     * also being sent there.
+     *
+     * @param   str   Text to write
+     */
+    void header(const std::string& str);
+
+    /**
+     * Sends a batch of records to all enabled destinations.  Batches must
+     * be written in time order.  The binary file is sized for every time
+     * on the view's time axis when the first batch is written.
+     *
+     * @param   view   Records to write
+     */
+    void write(const CompSeriesView& view);
+
+    /**
+     * Flushes and closes all destinations.
+     */
+    void close();
+
+  private:
+    std::string prefix;
+    std::vector<double> factors;            // Per band
+    std::vector<std::string> labels;        // Per band
+    bool do_text {false};
+    std::ostream* text_out {nullptr};
+    IoStage* text_io {nullptr};
+    std::unique_ptr<BufferedWriter> text;   // Only if do_text
+    std::unique_ptr<BufferedWriter> csv;
+    std::unique_ptr<CompBinaryWriter> bin;
+    const CompIFunction& func;
+    bool do_bin {false};
+    GregFormatter gfmt;
+      // Scratch reused by each batch
+    std::vector<const double*> cols;        // Per component
+    std::vector<double> scale;              // Per component
+};
+
+#endif  // COMP_REPORT_SINK_H
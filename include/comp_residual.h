@@ -0,0 +1,58 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMP_RESIDUAL_H
+#define COMP_RESIDUAL_H
+
+#include <cstddef>
+
+/**
+ * Batch kernels computing the magnitude of the difference between two
+ * sets of records stored in columnar form (see CompSeries).  The best
+ * instruction set available on the executing CPU (AVX2, SSE2, or plain
+ * scalar code) is selected at runtime the first time a kernel is called.
+ * All implementations perform the same operations in the same order, so
+ * results do not depend on the instruction set used.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompResidual {
+  public:
+    /**
+     * Absolute value of the difference of single valued records:
+     * out[i] = |a[i] - b[i]|
+     *
+     * @param   a     First set of values, n in length
+     * @param   b     Second set of values, n in length
+     * @param   out   Output residuals, n in length.  May alias a or b.
+     * @param   n     Number of records
+     */
+    static void abs_diff(const double* a, const double* b,
+                         double* out, std::size_t n);
+
+    /**
+     * L2 norm of the difference of vector valued records where each
+     * component is stored in its own column:
+     * out[i] = sqrt(sum_c (a[c][i] - b[c][i])^2)
+     *
+     * @param   a       Columns of first set of records, ncomp columns
+     *                  each n in length
+     * @param   b       Columns of second set of records
+     * @param   ncomp   Number of components in each record
+     * @param   out     Output residuals, n in length
+     * @param   n       Number of records
+     */
+    static void norm_diff(const double* const* a, const double* const* b,
+                          int ncomp, double* out, std::size_t n);
+
+    /** @return   Name of the instruction set selected for the kernels */
+    static const char* isa();
+};
+
+#endif  // COMP_RESIDUAL_H
@@ -9,7 +9,9 @@
 #ifndef COMP_RSS_H
 #define COMP_RSS_H
 
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <iostream>
 #include <map>
 #include <vector>
@@ -19,6 +21,8 @@
 #include <comp_ifunction.h>
 #include <comp_irecord.h>
 #include <comp_scalar.h>
+#include <comp_series.h>
+#include <comp_label_registry.h>
 
 /**
  * This function computes the Root Sum Square of the difference (residual)
@@ -43,15 +47,21 @@ class CompRSS : public CompIFunction {
      *                        [1] = Label of first function results to compare
      *                        [2] = Label of second function results to cmpare
      *                        [3] = Optional label/filename
-     * @param   comps         List of candidate functions from which to find
-     *                        corresponding labels that are to be compared.
+     * @param   comps         Functions defined so far, providing results
+     *                        to be compared
+     * @param   registry      Labels of the functions in comps, locating
+     *                        those to be compared
+     * @param   mr            Source of storage for results.  Must outlive
+     *                        this function.
      *
      * @throws   invalid_argument  Given a syntax error or inability to find
      *                             requested/compatible input labels in the
      *                             current list of functions being processed.
      */
     CompRSS(const std::vector<std::string>& funct_params,
-            const std::vector<std::unique_ptr<CompIFunction>>& comps);
+            const std::vector<std::unique_ptr<CompIFunction>>& comps,
+            const CompLabelRegistry& registry,
+            std::pmr::memory_resource* mr = std::pmr::get_default_resource());
 
     /**
      * Process analysis request using case definition values
@@ -61,27 +71,92 @@ class CompRSS : public CompIFunction {
     virtual void execute(const CompISimulation& cs);
 
     /**
-     * Create report of computed results consisting of formatted output
-     * and/or a .csv file.
+     * @return   True - residuals may be computed in chunks
+     */
+    virtual bool streams() const { return true; }
+
+    /**
+     * Checks input compatibility and sets up the output time axis.
+     *
+     * @param   cs   Calling simulation with general scenario information
+     *
+     * @return   Number of records to be computed, zero if the inputs are
+     *           not compatible
+     */
+    virtual std::size_t stream_begin(const CompISimulation& cs);
+
+    /**
+     * Computes residuals for a chunk of records of the inputs.
+     *
+     * @param   cs      Calling simulation
+     * @param   first   Zero based index of the first record
+     * @param   count   Maximum number of records
+     * @param   in      The chunk from each of the two compared functions
+     * @param   out     Receives the residuals
+     *
+     * @throws   logic_error if the input chunks don't match
+     */
+    virtual void stream_chunk(const CompISimulation& cs, std::size_t first,
+                              std::size_t count,
+                              const std::vector<CompSeriesView>& in,
+                              CompSeries& out) const;
+
+    /**
+     * Names of the compared functions and number of records compared.
      *
-     * @param   out   Stream for standard formatted output, if enabled.
+     * @param   out   Stream for standard formatted output
      */
-    virtual void report(std::ostream& out) const;
+    virtual void report_header(std::ostream& out) const;
 
     /**
-     * Retrieve a record of computed data given an index number.
-     * Index limit available through super class.
+     * @return   View of computed results
      */
-    virtual std::unique_ptr<CompIRecord> record(unsigned int ndx) const;
+    virtual CompSeriesView results() const { return cmp_lst.view(); }
+
+    /**
+     * Compresses saved outputs, see CompIFunction::pack_results()
+     */
+    virtual void pack_results() { cmp_lst.pack(); }
+
+    /**
+     * Restores saved outputs
+     */
+    virtual void unpack_results() { cmp_lst.unpack(); }
+
+    /**
+     * Frees saved outputs
+     */
+    virtual void release_results() { cmp_lst.clear(); }
 
   private:
-    bool found{false};
     unsigned int f1ndx {0};
     unsigned int f2ndx {0};
-    std::string label1 {""};
-    std::string label2 {""};
     const std::vector<std::unique_ptr<CompIFunction>> *comps_ptr;
-    std::vector<CompScalar> cmp_lst; 
+    CompSeries cmp_lst;
+    bool stream_ok {false};
+
+    /**
+     * @param   cv1    Results of the first input
+     * @param   cv2    Results of the second input
+     * @param   n1     Total number of records from the first input
+     * @param   n2     Total number of records from the second input
+     *
+     * @return   True if the input record layouts, unit bands, and start
+     *           times match, so records can be compared
+     */
+    bool compatible(const CompSeriesView& cv1, const CompSeriesView& cv2,
+                    std::size_t n1, std::size_t n2) const;
+
+    /**
+     * Sets each held output record to the residual of the corresponding
+     * input records.
+     *
+     * @param   cv1   Records of the first input
+     * @param   cv2   Records of the second input, same size as cv1
+     * @param   cs    Output records to set
+     */
+    void residual(const CompSeriesView& cv1, const CompSeriesView& cv2,
+                                             CompSeries& cs) const;
 };
 
 
@@ -0,0 +1,422 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMP_SERIES_H
+#define COMP_SERIES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include <astro_julian_date.h>
+#include <astro_exact_time.h>
+#include <comp_time_axis.h>
+#include <utl_gorilla.h>
+
+class CompSeriesView;
+
+/**
+ * Columnar storage for the time stamped records computed by a function.
+ * Rather than storing a full JulianDate and record object per output,
+ * record times are described by a CompTimeAxis, which may be shared with
+ * other result stores, and each record component is kept in its own
+ * contiguous value column.  Components are grouped into unit bands
+ * matching the unit types of the owning function (see
+ * CompIFunction::add_unit_type()).
+ * <P>
+ * A series on a shared time axis may instead hold only a window of
+ * consecutive records, so results may be produced and consumed a chunk at
+ * a time with memory bounded by the window size.  Record indices are
+ * then relative to the start of the window.
+ * <P>
+ * Once complete, values may be packed into compressed columns (see
+ * GorillaColumn) to reduce the memory held by results kept for later
+ * use.  While packed, values are available only through decode(), or
+ * after unpack().
+ * <P>
+ * Value columns are allocated from the memory resource given when the
+ * series is created, typically an arena scoped to the owning case.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompSeries {
+  public:
+    /**
+     * @param   mr   Source of value column storage.  Must outlive the
+     *               series.
+     */
+    explicit CompSeries(std::pmr::memory_resource* mr =
+                                         std::pmr::get_default_resource()) :
+                        vcols{mr}, ubands{mr} {}
+
+    /**
+     * Clears any existing data and sets the record layout.  Records are
+     * appended along with their times, building an explicit time axis
+     * owned by this series.
+     *
+     * @param   epoch   Reference time from which record times are offset
+     * @param   width   Number of values per record
+     * @param   bands   Zero based offset of each unit band within a record,
+     *                  in increasing order.  The first band must start at
+     *                  zero.
+     */
+    void reset(const ExactTime& epoch, int width,
+               const std::vector<int>& bands);
+
+    /**
+     * Clears any existing data and sets the record layout using an
+     * existing time axis.  One zero filled record is created for each
+     * axis time, to be populated through set() or column_data(), possibly
+     * out of order and concurrently.
+     *
+     * @param   axis    Times of records
+     * @param   width   Number of values per record
+     * @param   bands   See above
+     */
+    void reset(const std::shared_ptr<const CompTimeAxis>& axis, int width,
+               const std::vector<int>& bands);
+
+    /**
+     * Clears any existing data and sets the record layout using an
+     * existing time axis, with storage for only a window of records.
+     *
+     * @param   axis    Times of records
+     * @param   width   Number of values per record
+     * @param   bands   See above
+     * @param   first   Index within the axis of the first record held
+     * @param   count   Number of records held
+     */
+    void reset(const std::shared_ptr<const CompTimeAxis>& axis, int width,
+               const std::vector<int>& bands, std::size_t first,
+                                              std::size_t count);
+
+    /**
+     * Replaces held records with a new window of zero filled records,
+     * to be populated as with reset().  Storage is reused.
+     *
+     * @param   first   Index within the axis of the first record held
+     * @param   count   Number of records held
+     *
+     * @throws   logic_error if the series owns its time axis
+     * @throws   out_of_range if the window extends past the axis
+     */
+    void window(std::size_t first, std::size_t count);
+
+    /** @return   Index within the time axis of the first record held */
+    std::size_t first_index() const { return base; }
+
+    /**
+     * Frees all records, retaining the time axis description (but not
+     * explicit times) and record layout.
+     */
+    void clear();
+
+    /**
+     * @param   n   Number of records for which to reserve storage
+     */
+    void reserve(std::size_t n);
+
+    /**
+     * Appends a single valued record to a series with its own time axis.
+     *
+     * @param   jd    Time of record
+     * @param   val   Record value
+     */
+    void push_back(const JulianDate& jd, double val);
+
+    /**
+     * Appends a record to a series with its own time axis.
+     *
+     * @param   offset_ns   Time of record, nanoseconds from epoch()
+     * @param   vals        Record values, width() in length
+     */
+    void push_back(std::int64_t offset_ns, const double* vals);
+
+    /**
+     * Replaces the value of a single valued record.  Distinct records may
+     * be set concurrently.
+     *
+     * @param   ndx   Zero based record index, less than size()
+     * @param   val   Record value
+     */
+    void set(std::size_t ndx, double val) { vcols[0][ndx] = val; }
+
+    /** @return   Number of records */
+    std::size_t size() const
+    {
+      if (packed) {
+        return npacked;
+      }
+      return vcols.empty() ? 0 : vcols[0].size();
+    }
+
+    /** @return   Number of values in each record */
+    int width() const { return static_cast<int>(vcols.size()); }
+
+    /** @return   Times associated with records */
+    const CompTimeAxis& axis() const { return *taxis; }
+
+    /** @return   Shared handle to times associated with records */
+    const std::shared_ptr<const CompTimeAxis>& axis_ptr() const
+    {
+      return taxis;
+    }
+
+    /** @return   Time from which record times are offset */
+    const ExactTime& epoch() const { return taxis->epoch(); }
+
+    /**
+     * @param   ndx   Zero based record index
+     *
+     * @return   Time of record
+     */
+    JulianDate time(std::size_t ndx) const
+    {
+      return taxis->time(base + ndx);
+    }
+
+    /**
+     * @param   ndx   Zero based record index
+     *
+     * @return   Exact time of record
+     */
+    ExactTime exact(std::size_t ndx) const
+    {
+      return taxis->exact(base + ndx);
+    }
+
+    /**
+     * @param   ndx   Zero based record index
+     *
+     * @return   Time of record, nanoseconds from epoch()
+     */
+    std::int64_t time_offset(std::size_t ndx) const
+    {
+      return taxis->offset(base + ndx);
+    }
+
+    /**
+     * @param   ndx    Zero based record index
+     * @param   comp   Zero based component within the record
+     *
+     * @return   Record value
+     */
+    double value(std::size_t ndx, int comp = 0) const
+    {
+      return vcols[comp][ndx];
+    }
+
+    /**
+     * @param   comp   Zero based component within the record
+     *
+     * @return   Contiguous column of values for the record component
+     */
+    const std::pmr::vector<double>& column(int comp) const
+    {
+      return vcols[comp];
+    }
+
+    /**
+     * @param   comp   Zero based component within the record
+     *
+     * @return   Writable values for the record component, size() in
+     *           length.
+     */
+    double* column_data(int comp) { return vcols[comp].data(); }
+
+    /**
+     * @return   Read only view of all records
+     *
+     * @throws   logic_error if packed
+     */
+    CompSeriesView view() const;
+
+    /**
+     * Compresses all value columns, releasing the uncompressed values.
+     * Values are restored bit for bit by unpack() or decode().  Does
+     * nothing if already packed.
+     */
+    void pack();
+
+    /**
+     * Restores uncompressed value columns from packed storage.  Does
+     * nothing if not packed.
+     */
+    void unpack();
+
+    /** @return   True if values are held in compressed form */
+    bool is_packed() const { return packed; }
+
+    /** @return   Bytes of storage held for values, packed or not */
+    std::size_t stored_bytes() const;
+
+    /**
+     * Copies a range of values for a single record component, decoding
+     * them if packed.  Any range may be decoded without decoding the
+     * values preceding it.
+     *
+     * @param   first   Zero based index of first record
+     * @param   n       Number of records
+     * @param   comp    Zero based component within the record
+     * @param   out     Destination for n values
+     */
+    void decode(std::size_t first, std::size_t n, int comp,
+                                                  double* out) const;
+
+    /** @return   Number of unit bands */
+    int num_bands() const { return static_cast<int>(ubands.size()); }
+
+    /**
+     * @param   band   Zero based unit band
+     *
+     * @return   Component at which the band starts
+     */
+    int band_offset(int band) const { return ubands[band]; }
+
+    /**
+     * @param   band   Zero based unit band
+     *
+     * @return   Number of consecutive components in the band
+     */
+    int band_width(int band) const;
+
+  private:
+    std::shared_ptr<const CompTimeAxis> taxis;
+    std::shared_ptr<CompTimeAxis> own_axis;  // Non-null if built here
+      // Column per record component, sharing the series memory resource
+    std::pmr::vector<std::pmr::vector<double>> vcols;
+    std::pmr::vector<int> ubands;           // Component offset per band
+    std::size_t base {0};                   // Axis index of record 0
+    std::vector<GorillaColumn> pcols;       // Packed vcols
+    std::size_t npacked {0};
+    bool packed {false};
+
+    void set_layout(int width, const std::vector<int>& bands);
+};
+
+
+/**
+ * Non-owning, read only view of a contiguous range of records within a
+ * CompSeries.  Values are exposed as raw contiguous arrays and times
+ * through the series time axis so they may be walked without allocation
+ * or virtual dispatch.  Views are
+ * cheap to copy and are invalidated by any modification of the
+ * underlying series.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompSeriesView {
+  public:
+    /** Empty view */
+    CompSeriesView() {}
+
+    /**
+     * @param   cs      Series to view
+     * @param   first   Zero based index of first record in view
+     * @param   count   Number of records in view
+     */
+    CompSeriesView(const CompSeries& cs, std::size_t first,
+                                         std::size_t count) :
+                                   src{&cs}, ndx0{first}, nrec{count} {}
+
+    /** @return   Number of records in view */
+    std::size_t size() const { return nrec; }
+
+    /** @return   Number of values in each record */
+    int width() const { return (src != nullptr) ? src->width() : 0; }
+
+    /** @return   Index of the first record within the time axis */
+    std::size_t first() const
+    {
+      return (src != nullptr) ? src->first_index() + ndx0 : ndx0;
+    }
+
+    /** @return   Time from which record times are offset */
+    const ExactTime& epoch() const { return src->epoch(); }
+
+    /** @return   Times associated with the full series */
+    const CompTimeAxis& axis() const { return src->axis(); }
+
+    /** @return   Shared handle to times associated with the full series */
+    const std::shared_ptr<const CompTimeAxis>& axis_ptr() const
+    {
+      return src->axis_ptr();
+    }
+
+    /**
+     * @param   ndx   Zero based record index within this view
+     *
+     * @return   Time of record, nanoseconds from epoch()
+     */
+    std::int64_t time_offset(std::size_t ndx) const
+    {
+      return src->time_offset(ndx0 + ndx);
+    }
+
+    /**
+     * @param   comp   Zero based component within the record
+     *
+     * @return   Values for the record component, size() in length
+     */
+    const double* values(int comp = 0) const
+    {
+      return src->column(comp).data() + ndx0;
+    }
+
+    /**
+     * @param   ndx   Zero based record index within this view
+     *
+     * @return   Time of record
+     */
+    JulianDate time(std::size_t ndx) const { return src->time(ndx0 + ndx); }
+
+    /**
+     * @param   ndx   Zero based record index within this view
+     *
+     * @return   Exact time of record
+     */
+    ExactTime exact(std::size_t ndx) const { return src->exact(ndx0 + ndx); }
+
+    /** @return   Number of unit bands */
+    int num_bands() const { return src->num_bands(); }
+
+    /** @return   Component at which the band starts */
+    int band_offset(int band) const { return src->band_offset(band); }
+
+    /** @return   Number of consecutive components in the band */
+    int band_width(int band) const { return src->band_width(band); }
+
+    /**
+     * @param   chunk_size   Maximum number of records per chunk
+     *
+     * @return   Number of chunks required to cover this view
+     */
+    std::size_t num_chunks(std::size_t chunk_size) const
+    {
+      return (nrec + chunk_size - 1)/chunk_size;
+    }
+
+    /**
+     * @param   chunk        Zero based chunk number
+     * @param   chunk_size   Maximum number of records per chunk
+     *
+     * @return   View of the records making up the requested chunk
+     */
+    CompSeriesView chunk(std::size_t chunk, std::size_t chunk_size) const;
+
+  private:
+    const CompSeries* src {nullptr};
+    std::size_t ndx0 {0};
+    std::size_t nrec {0};
+};
+
+#endif  // COMP_SERIES_H
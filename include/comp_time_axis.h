@@ -0,0 +1,132 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMP_TIME_AXIS_H
+#define COMP_TIME_AXIS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <astro_julian_date.h>
+#include <astro_exact_time.h>
+
+/**
+ * The set of times at which a function's records are computed.  A uniform
+ * axis is fully described by an epoch, step size, and count, requiring no
+ * per record storage.  An explicit axis stores the offset of each record
+ * time from the epoch.  Times are held in exact fixed point form so grid
+ * times are free of accumulated stepping error and compare exactly
+ * between axes.  An axis may be shared by any number of result stores.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompTimeAxis {
+  public:
+    /** Returned by lookups that fall outside the axis */
+    static constexpr std::size_t NPOS {static_cast<std::size_t>(-1)};
+
+    /**
+     * Initialize an explicit axis with no times.
+     *
+     * @param   epoch   Time from which record times are offset
+     */
+    explicit CompTimeAxis(const ExactTime& epoch) : et0{epoch} {}
+
+    /**
+     * Initialize a uniform axis.
+     *
+     * @param   epoch     Time of the first record
+     * @param   step_ns   Time between records, nanoseconds (positive)
+     * @param   count     Number of records
+     */
+    CompTimeAxis(const ExactTime& epoch, std::int64_t step_ns,
+                                         std::size_t count) :
+                   et0{epoch}, uniform{true}, dt{step_ns}, npts{count} {}
+
+    /**
+     * Appends a time to an explicit axis.  Times must be added in
+     * increasing order.
+     *
+     * @param   offset_ns   Nanoseconds from epoch()
+     *
+     * @throws   logic_error if this is a uniform axis
+     */
+    void push_back(std::int64_t offset_ns);
+
+    /**
+     * @param   n   Number of times for which to reserve storage
+     */
+    void reserve(std::size_t n) { toff.reserve(n); }
+
+    /** @return   True if the axis is a uniform grid */
+    bool is_uniform() const { return uniform; }
+
+    /** @return   Number of times */
+    std::size_t size() const { return uniform ? npts : toff.size(); }
+
+    /** @return   Time from which all times are offset */
+    const ExactTime& epoch() const { return et0; }
+
+    /** @return   Time between records for a uniform axis, nanoseconds */
+    std::int64_t step() const { return dt; }
+
+    /**
+     * @param   ndx   Zero based index
+     *
+     * @return   Time, nanoseconds from epoch()
+     */
+    std::int64_t offset(std::size_t ndx) const
+    {
+      return uniform ? static_cast<std::int64_t>(ndx)*dt : toff[ndx];
+    }
+
+    /**
+     * @param   ndx   Zero based index
+     *
+     * @return   Exact time
+     */
+    ExactTime exact(std::size_t ndx) const { return et0 + offset(ndx); }
+
+    /**
+     * @param   ndx   Zero based index
+     *
+     * @return   Time in two part Julian Date form
+     */
+    JulianDate time(std::size_t ndx) const { return exact(ndx).to_jd(); }
+
+    /**
+     * Locates the last time at or before the requested time.  This is a
+     * constant time operation for a uniform axis and a binary search
+     * otherwise.
+     *
+     * @param   et   Time of interest
+     *
+     * @return   Zero based index, or NPOS if et precedes the first time
+     *           or the axis is empty
+     */
+    std::size_t floor_index(const ExactTime& et) const;
+
+    /**
+     * @param   axis   Axis to compare against
+     *
+     * @return   True if every time on both axes is identical.  Uniform
+     *           axes are compared without evaluating each time.
+     */
+    bool same_times(const CompTimeAxis& axis) const;
+
+  private:
+    ExactTime et0;                          // Epoch
+    bool uniform {false};
+    std::int64_t dt {0};                    // Uniform step, ns
+    std::size_t npts {0};                   // Uniform count
+    std::vector<std::int64_t> toff;         // Explicit offsets from et0, ns
+};
+
+#endif  // COMP_TIME_AXIS_H
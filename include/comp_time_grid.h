@@ -0,0 +1,202 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMP_TIME_GRID_H
+#define COMP_TIME_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <astro_julian_date.h>
+#include <astro_exact_time.h>
+#include <astro_leap_sec.h>
+#include <astro_ut1mutc.h>
+#include <comp_time_axis.h>
+#include <utl_thread_pool.h>
+
+/**
+ * A uniform UTC time grid along with the same epochs expressed in the
+ * TAI, TT, and UT1 time scales.  UT1 and TT are given in the two part
+ * Julian Date form expected by SOFA, with the whole UTC day as the high
+ * part.  Only UT1 - UTC varies from point to point, so only the low part
+ * of UT1 is stored, computed once when the grid is created so every
+ * function on the same grid shares a single conversion pass.  TAI and TT
+ * are formed on request from the UTC time and the TAI - UTC of its leap
+ * second segment.  Grids are immutable once created.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompTimeGrid {
+  public:
+    /** TT - TAI, seconds */
+    static constexpr double TTMTAI {32.184};
+
+    /**
+     * Computes time scale conversions for each point of a uniform grid.
+     *
+     * @param   start      UTC time of the first grid point
+     * @param   step_ns    Time between grid points, nanoseconds (positive)
+     * @param   count      Number of grid points
+     * @param   leap_sec   TAI - UTC source
+     * @param   ut1mutc    UT1 - UTC source
+     * @param   pool       If not null, used to split up the conversions
+     * @param   mr         Source of storage for the conversions.  Must
+     *                     outlive the grid.
+     */
+    CompTimeGrid(const ExactTime& start, std::int64_t step_ns,
+                 std::size_t count, const LeapSec& leap_sec,
+                 const UT1mUTC& ut1mutc, ThreadPool* pool,
+                 std::pmr::memory_resource* mr =
+                                         std::pmr::get_default_resource());
+
+    CompTimeGrid(const CompTimeGrid&) = delete;
+    CompTimeGrid& operator=(const CompTimeGrid&) = delete;
+
+    /** @return   Number of grid points */
+    std::size_t size() const { return taxis->size(); }
+
+    /** @return   UTC time axis, suitable for sharing with result stores */
+    const std::shared_ptr<const CompTimeAxis>& axis_ptr() const
+    {
+      return taxis;
+    }
+
+    /**
+     * @param   ndx   Zero based index
+     *
+     * @return   UTC, exact
+     */
+    ExactTime utc(std::size_t ndx) const { return taxis->exact(ndx); }
+
+    /**
+     * @param   ndx   Zero based index
+     *
+     * @return   TAI - UTC, seconds
+     */
+    double tai_utc(std::size_t ndx) const;
+
+    /**
+     * @param   ndx   Zero based index
+     *
+     * @return   TAI, two part Julian Date
+     */
+    JulianDate tai(std::size_t ndx) const
+    {
+      return JulianDate(tt_hi_val(ndx), tt_low_val(ndx)) +
+                       (-TTMTAI*JulianDate::DAY_PER_SEC);
+    }
+
+    /** @return   High part of the TT Julian Date at ndx */
+    double tt_hi_val(std::size_t ndx) const { return utc(ndx).jd_hi(); }
+
+    /** @return   Low part of the TT Julian Date at ndx */
+    double tt_low_val(std::size_t ndx) const
+    {
+      return utc(ndx).jd_low() +
+             (tai_utc(ndx) + TTMTAI)*JulianDate::DAY_PER_SEC;
+    }
+
+    /** @return   High part of the UT1 Julian Date at ndx */
+    double ut1_hi_val(std::size_t ndx) const { return utc(ndx).jd_hi(); }
+
+    /** @return   Low part of the UT1 Julian Date at ndx */
+    double ut1_low_val(std::size_t ndx) const { return ut1_low[ndx]; }
+
+  private:
+    std::shared_ptr<const CompTimeAxis> taxis;
+    std::pmr::vector<LeapSec::Segment> segs;    // Constant TAI - UTC spans
+    std::pmr::vector<double> ut1_low;
+};
+
+
+/**
+ * Memoizes time grids by (start, step, count) so functions sampling the
+ * simulation at the same rate share one set of conversions.  Safe for
+ * concurrent use - when several threads request the same new grid, one
+ * computes it while the others wait.  Grids are allocated from the
+ * memory resource given to the cache.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CompTimeGridCache {
+  public:
+    /**
+     * @param   mr   Source of storage for grids.  Must outlive the cache
+     *               and every grid it hands out.
+     */
+    explicit CompTimeGridCache(std::pmr::memory_resource* mr =
+                                         std::pmr::get_default_resource()) :
+                               arena{mr}, grids{mr} {}
+
+    /**
+     * @param   start      UTC time of the first grid point
+     * @param   step_ns    Time between grid points, nanoseconds (positive)
+     * @param   count      Number of grid points
+     * @param   leap_sec   TAI - UTC source used if the grid is created
+     * @param   ut1mutc    UT1 - UTC source used if the grid is created
+     * @param   pool       Used to split up the work of a new grid.  May
+     *                     be null.
+     *
+     * @return   Existing grid for these parameters, or a newly created one
+     */
+    std::shared_ptr<const CompTimeGrid> get(const ExactTime& start,
+                                            std::int64_t step_ns,
+                                            std::size_t count,
+                                            const LeapSec& leap_sec,
+                                            const UT1mUTC& ut1mutc,
+                                            ThreadPool* pool);
+
+    /**
+     * Releases all grids.  Grids still in use are freed once released by
+     * their users.
+     */
+    void clear();
+
+    /**
+     * Releases all grids with the given step.  Grids still in use are
+     * freed once released by their users.
+     *
+     * @param   step_ns   Time between grid points, nanoseconds
+     */
+    void release(std::int64_t step_ns);
+
+    /**
+     * Limits the number of grids retained, releasing the oldest as new
+     * grids are created.  Used when grids cover short spans that are
+     * each needed only briefly.
+     *
+     * @param   max_grids   Maximum number of grids retained, zero for no
+     *                      limit
+     */
+    void limit(std::size_t max_grids);
+
+  private:
+    struct Slot {
+      std::once_flag once;
+      std::shared_ptr<const CompTimeGrid> grid;
+    };
+    typedef std::tuple<std::int64_t, std::int64_t,
+                       std::int64_t, std::size_t> Key;
+
+    std::pmr::memory_resource* arena;
+    std::mutex mtx;
+    std::pmr::map<Key, std::shared_ptr<Slot>> grids;
+    std::deque<Key> created;                // Oldest first, if limited
+    std::size_t max_size {0};
+};
+
+#endif  // COMP_TIME_GRID_H
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_BOUNDED_QUEUE_H
+#define UTL_BOUNDED_QUEUE_H
+
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+ * A FIFO queue holding at most a fixed number of items, for passing work
+ * between threads.  Producers block while the queue is full and consumers
+ * block while it is empty, so a fast producer can't run ahead of its
+ * consumer by more than the capacity.  Once closed, pushes are rejected
+ * and consumers drain the remaining items before being told the queue is
+ * finished.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+template<typename T>
+class BoundedQueue {
+  public:
+    /**
+     * @param   capacity   Maximum number of queued items (minimum of one)
+     */
+    explicit BoundedQueue(std::size_t capacity) :
+                                  cap{(capacity > 0) ? capacity : 1} {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /**
+     * Adds an item, waiting for room if the queue is full.
+     *
+     * @param   item   Item to move into the queue
+     *
+     * @return   False if the queue was closed, in which case item is
+     *           left untouched
+     */
+    bool push(T&& item)
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      not_full.wait(lock, [this] { return closed  ||  items.size() < cap; });
+      if (closed) {
+        return false;
+      }
+      items.push_back(std::move(item));
+      not_empty.notify_one();
+      return true;
+    }
+
+    /**
+     * Removes the oldest item, waiting for one if the queue is empty.
+     *
+     * @param   item   Receives the removed item
+     *
+     * @return   False if the queue is closed and empty
+     */
+    bool pop(T& item)
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      not_empty.wait(lock, [this] { return closed  ||  !items.empty(); });
+      if (items.empty()) {
+        return false;
+      }
+      item = std::move(items.front());
+      items.pop_front();
+      not_full.notify_one();
+      return true;
+    }
+
+    /**
+     * Rejects further pushes and wakes all waiting threads.  Items
+     * already queued may still be popped.
+     */
+    void close()
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      closed = true;
+      not_full.notify_all();
+      not_empty.notify_all();
+    }
+
+    /** @return   Maximum number of queued items */
+    std::size_t capacity() const { return cap; }
+
+  private:
+    std::size_t cap;
+    bool closed {false};
+    std::deque<T> items;
+    std::mutex mtx;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+};
+
+#endif  // UTL_BOUNDED_QUEUE_H
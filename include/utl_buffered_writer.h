@@ -0,0 +1,126 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_BUFFERED_WRITER_H
+#define UTL_BUFFERED_WRITER_H
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <utl_io_stage.h>
+
+/**
+ * Accumulates text in a large buffer, passing it on to the destination
+ * stream only when the buffer fills or is flushed.  Numbers are formatted
+ * in place with std::to_chars - no locale, no format string parsing, and
+ * no temporary strings.  The destination is either a stream owned by the
+ * caller or a file opened (and owned) by the writer.  Remaining text is
+ * flushed on destruction.
+ * <P>
+ * If given an IoStage, full buffers are handed to the stage's writer
+ * thread rather than written directly, so formatting continues while
+ * earlier output is being written.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class BufferedWriter {
+  public:
+    /** Default buffer size, bytes */
+    static constexpr std::size_t DEFAULT_SIZE {1 << 20};
+
+    /**
+     * @param   os   Destination stream, must outlive this writer
+     * @param   io   If not null, performs writes in the background.  Must
+     *               outlive this writer.
+     */
+    explicit BufferedWriter(std::ostream& os, IoStage* io = nullptr);
+
+    /**
+     * Opens a file for writing.  Check is_open() for success.
+     *
+     * @param   filename   File to create or truncate
+     * @param   io         If not null, performs writes in the background.
+     *                     Must outlive this writer.
+     */
+    explicit BufferedWriter(const std::string& filename,
+                            IoStage* io = nullptr);
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    ~BufferedWriter();
+
+    /** @return   True if the destination is available for writing */
+    bool is_open() const { return os != nullptr; }
+
+    /**
+     * @param   c   Character to append
+     */
+    void put(char c)
+    {
+      if (len == buf.size()) {
+        drain();
+      }
+      buf[len++] = c;
+    }
+
+    /**
+     * @param   str   Text to append
+     * @param   n     Number of characters
+     */
+    void write(const char* str, std::size_t n);
+
+    /**
+     * @param   str   Null terminated text to append
+     */
+    void write(const char* str) { write(str, std::strlen(str)); }
+
+    /**
+     * @param   str   Text to append
+     */
+    void write(const std::string& str) { write(str.data(), str.size()); }
+
+    /**
+     * Appends the shortest text that reads back as exactly the same value.
+     *
+     * @param   val   Value to append
+     */
+    void write_shortest(double val);
+
+    /**
+     * Appends a value in fixed notation, as printf("%1.*f").
+     *
+     * @param   val         Value to append
+     * @param   precision   Digits after the decimal point
+     */
+    void write_fixed(double val, int precision);
+
+    /**
+     * Passes all buffered text to the destination stream and flushes it.
+     * With an IoStage, waits until the text has been written.
+     */
+    void flush();
+
+  private:
+    std::unique_ptr<std::ofstream> own_file;
+    std::ostream* os {nullptr};
+    IoStage* stage {nullptr};
+    std::vector<char> buf;
+    std::size_t len {0};
+
+    char* reserve(std::size_t n);
+    void drain();
+};
+
+#endif  // UTL_BUFFERED_WRITER_H
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_CASE_TOKENIZER_H
+#define UTL_CASE_TOKENIZER_H
+
+#include <cstddef>
+#include <string_view>
+
+/**
+ * Splits case file text into whitespace separated tokens in a single
+ * pass.  A token starting with '#' begins a comment running to the end
+ * of the line, which is skipped.  Tokens are views into the text, so
+ * nothing is copied or allocated, and the text must outlive them.  The
+ * line and column of each token are tracked as the text is scanned.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class CaseTokenizer {
+  public:
+    /**
+     * @param   text   Text to tokenize
+     */
+    explicit CaseTokenizer(std::string_view text) : src{text} {}
+
+    /**
+     * @param   token   Set to the next token, if any
+     *
+     * @return   False once the end of the text is reached
+     */
+    bool next(std::string_view& token);
+
+    /** @return   Line, starting at one, of the last token returned */
+    int line() const { return tok_line; }
+
+    /** @return   Column, starting at one, of the last token returned */
+    int column() const { return tok_col; }
+
+    /** @return   Offset within the text of the last token returned */
+    std::size_t offset() const { return tok_start; }
+
+    /** @return   Offset within the text just past the last token returned */
+    std::size_t end_offset() const { return tok_end; }
+
+    /** @return   Text being tokenized */
+    std::string_view text() const { return src; }
+
+  private:
+    std::string_view src;
+    std::size_t pos {0};                    // Next character to scan
+    int cur_line {1};                       // Line containing pos
+    std::size_t line_start {0};             // Offset of cur_line
+    std::size_t tok_start {0};
+    std::size_t tok_end {0};
+    int tok_line {1};
+    int tok_col {1};
+};
+
+#endif  // UTL_CASE_TOKENIZER_H
@@ -0,0 +1,168 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_GORILLA_H
+#define UTL_GORILLA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * Growable sequence of bits, written most significant bit first.  Bytes
+ * are always complete - unused low bits of the last byte are zero - so
+ * the data may be read back, or further bits appended, at any time.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class BitStream {
+  public:
+    /**
+     * @param   val     Bits to append, right justified
+     * @param   nbits   Number of low bits of val to append, 0 to 64
+     */
+    void put(std::uint64_t val, int nbits);
+
+    /**
+     * Pads with zero bits to the next byte boundary.
+     */
+    void align() { nbit = (nbit + 7) & ~static_cast<std::size_t>(7); }
+
+    /** @return   Number of bits written */
+    std::size_t bits() const { return nbit; }
+
+    /** @return   Encoded bytes */
+    const std::vector<std::uint8_t>& bytes() const { return data; }
+
+    /**
+     * Discards all bits, releasing storage.
+     */
+    void clear()
+    {
+      std::vector<std::uint8_t>().swap(data);
+      nbit = 0;
+    }
+
+  private:
+    std::vector<std::uint8_t> data;
+    std::size_t nbit {0};
+};
+
+
+/**
+ * Compressed storage for a column of doubles using the XOR encoding of
+ * the Facebook Gorilla time series database.  Each value is XORed with
+ * the previous one and only the bits that differ are stored, sharing the
+ * leading/trailing zero window of the previous value when it still
+ * applies.  Values are encoded in independent blocks of BLOCK values so
+ * any range may be decoded without decoding from the start.  Decoding
+ * restores values bit for bit.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class GorillaColumn {
+  public:
+    /** Number of values per independently decodable block */
+    static constexpr std::size_t BLOCK {1024};
+
+    /**
+     * @param   vals   Values to append
+     * @param   n      Number of values
+     */
+    void append(const double* vals, std::size_t n);
+
+    /** @return   Number of values stored */
+    std::size_t size() const { return count; }
+
+    /**
+     * @param   first   Index of first value to decode
+     * @param   n       Number of values to decode
+     * @param   out     Destination for n values
+     */
+    void decode(std::size_t first, std::size_t n, double* out) const;
+
+    /** @return   Encoded values */
+    const std::vector<std::uint8_t>& bytes() const { return bs.bytes(); }
+
+    /** @return   Byte offset within bytes() of the start of each block */
+    const std::vector<std::uint64_t>& block_offsets() const
+    {
+      return blocks;
+    }
+
+    /**
+     * Discards all values, releasing storage.
+     */
+    void clear();
+
+  private:
+    BitStream bs;
+    std::vector<std::uint64_t> blocks;
+    std::size_t count {0};
+    std::uint64_t prev {0};
+    int lead {0};
+    int trail {0};
+};
+
+
+/**
+ * Compressed storage for a column of integers, typically time stamps,
+ * using delta-of-delta encoding.  For regularly spaced times the change
+ * in spacing is usually zero and costs a single bit.  Small changes use a
+ * few bits and anything else is stored in full.  Values are encoded in
+ * independent blocks of BLOCK values.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class DodColumn {
+  public:
+    /** Number of values per independently decodable block */
+    static constexpr std::size_t BLOCK {1024};
+
+    /**
+     * @param   vals   Values to append
+     * @param   n      Number of values
+     */
+    void append(const std::int64_t* vals, std::size_t n);
+
+    /** @return   Number of values stored */
+    std::size_t size() const { return count; }
+
+    /**
+     * @param   first   Index of first value to decode
+     * @param   n       Number of values to decode
+     * @param   out     Destination for n values
+     */
+    void decode(std::size_t first, std::size_t n, std::int64_t* out) const;
+
+    /** @return   Encoded values */
+    const std::vector<std::uint8_t>& bytes() const { return bs.bytes(); }
+
+    /** @return   Byte offset within bytes() of the start of each block */
+    const std::vector<std::uint64_t>& block_offsets() const
+    {
+      return blocks;
+    }
+
+    /**
+     * Discards all values, releasing storage.
+     */
+    void clear();
+
+  private:
+    BitStream bs;
+    std::vector<std::uint64_t> blocks;
+    std::size_t count {0};
+    std::int64_t prev {0};
+    std::int64_t prev_delta {0};
+};
+
+#endif  // UTL_GORILLA_H
@@ -0,0 +1,55 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_GREG_FORMATTER_H
+#define UTL_GREG_FORMATTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Formats a series of times as Gregorian calendar text of the form
+ * "YYYY/MM/DD HH:MM:SS.ss", the same layout as JulianDate::to_str().
+ * Meant for writing reports of many records:  the calendar date is only
+ * recomputed when the day changes, and is then simply advanced by one day
+ * when the series moves on to the next day.  Times of day are formatted
+ * from integer nanoseconds, so seconds are truncated to hundredths without
+ * floating point error.  Text is written to an internal buffer that is
+ * reused by each call - nothing is allocated per record.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class GregFormatter {
+  public:
+    /** Number of characters in formatted text, excluding terminator */
+    static constexpr std::size_t LENGTH {22};
+
+    GregFormatter();
+
+    /**
+     * @param   mjd_day     Modified Julian Day number
+     * @param   ns_of_day   Nanoseconds into the day, 0 <= ns < 1 day
+     *
+     * @return   Null terminated text, valid until the next call
+     */
+    const char* format(std::int64_t mjd_day, std::int64_t ns_of_day);
+
+  private:
+    std::int64_t day;                       // MJD of the current date text
+    int yr {0};
+    int mnth {0};
+    int dy {0};
+    char buf[LENGTH + 1];
+
+    void set_date(std::int64_t mjd_day);
+    void next_day();
+    void write_date();
+};
+
+#endif  // UTL_GREG_FORMATTER_H
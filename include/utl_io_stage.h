@@ -0,0 +1,97 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_IO_STAGE_H
+#define UTL_IO_STAGE_H
+
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include <utl_bounded_queue.h>
+
+/**
+ * A background thread performing the stream writes for buffers filled
+ * elsewhere, so formatting and writing output proceed concurrently.
+ * Buffers are written in the order submitted.  The submission queue is
+ * bounded - when the writer falls behind, submitters wait - so memory
+ * held by queued output is capped at about the queue depth times the
+ * buffer size.  Written buffers are recycled rather than freed.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class IoStage {
+  public:
+    /** Default maximum number of buffers waiting to be written */
+    static constexpr std::size_t DEFAULT_DEPTH {8};
+
+    /** Default size of buffers handed out by acquire(), bytes */
+    static constexpr std::size_t DEFAULT_BUFSIZE {1 << 20};
+
+    /**
+     * Starts the writer thread.
+     *
+     * @param   depth     Maximum number of buffers waiting to be written
+     * @param   bufsize   Size of buffers handed out by acquire(), bytes
+     */
+    explicit IoStage(std::size_t depth = DEFAULT_DEPTH,
+                     std::size_t bufsize = DEFAULT_BUFSIZE);
+
+    IoStage(const IoStage&) = delete;
+    IoStage& operator=(const IoStage&) = delete;
+
+    /**
+     * Writes all submitted buffers and joins the writer thread.
+     */
+    ~IoStage();
+
+    /**
+     * @return   An empty buffer, recycled if available, sized to the
+     *           stage buffer size
+     */
+    std::vector<char> acquire();
+
+    /**
+     * Queues a buffer to be written, waiting if the queue is full.
+     *
+     * @param   os    Destination, must remain valid until sync(os) returns
+     * @param   buf   Buffer to write, handed over to the stage
+     * @param   len   Number of bytes of buf to write
+     */
+    void submit(std::ostream* os, std::vector<char>&& buf, std::size_t len);
+
+    /**
+     * Waits until every buffer submitted so far has been written, and
+     * then until the destination has been flushed.
+     *
+     * @param   os   Destination to flush
+     */
+    void sync(std::ostream* os);
+
+  private:
+    struct Item {
+      std::ostream* os {nullptr};
+      std::vector<char> buf;
+      std::size_t len {0};
+      std::promise<void>* done {nullptr};  // Non-null to request a flush
+    };
+
+    std::size_t bsz;
+    BoundedQueue<Item> items;
+    std::mutex free_mtx;
+    std::vector<std::vector<char>> free_bufs;
+    std::thread writer;
+
+    void run();
+};
+
+#endif  // UTL_IO_STAGE_H
@@ -0,0 +1,54 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_MAPPED_FILE_H
+#define UTL_MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * Read only view of the full contents of a file.  Regular files are
+ * memory mapped so their text is available without copying.  Anything
+ * that can't be mapped, such as a pipe, is read into memory instead.
+ * The text remains valid for the life of the object.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class MappedFile {
+  public:
+    /**
+     * @param   file_name   Name of file to open
+     */
+    explicit MappedFile(const std::string& file_name);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Unmaps the file, if mapped.
+     */
+    ~MappedFile();
+
+    /** @return   True if the file was opened and read */
+    bool is_open() const { return opened; }
+
+    /** @return   Contents of the file, empty if not open */
+    std::string_view text() const { return std::string_view(addr, len); }
+
+  private:
+    const char* addr {nullptr};
+    std::size_t len {0};
+    bool mapped {false};
+    bool opened {false};
+    std::string copy;                       // Contents if not mapped
+};
+
+#endif  // UTL_MAPPED_FILE_H
@@ -0,0 +1,175 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_SPSC_QUEUE_H
+#define UTL_SPSC_QUEUE_H
+
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * A bounded, lock free FIFO queue connecting exactly one producer thread
+ * to exactly one consumer thread.  Items are held in a ring buffer
+ * indexed by two counters, each written by only one side, so neither
+ * side ever blocks the other on a lock.  Waiting push() and pop() calls
+ * spin briefly, then yield, then sleep, so an idle side does not hold a
+ * core.  Once closed, pushes are rejected and the consumer drains the
+ * remaining items before being told the queue is finished.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+template<typename T>
+class SpscQueue {
+  public:
+    /**
+     * @param   capacity   Maximum number of queued items, rounded up to a
+     *                     power of two (minimum of one)
+     */
+    explicit SpscQueue(std::size_t capacity)
+    {
+      std::size_t cap {1};
+      while (cap < capacity) {
+        cap <<= 1;
+      }
+      slots.resize(cap);
+      mask = cap - 1;
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * Adds an item if there is room.  Producer thread only.
+     *
+     * @param   item   Item to move into the queue
+     *
+     * @return   False if the queue is full, leaving item untouched
+     */
+    bool try_push(T&& item)
+    {
+      std::size_t t = tail.load(std::memory_order_relaxed);
+      if (t - head.load(std::memory_order_acquire) > mask) {
+        return false;
+      }
+      slots[t & mask] = std::move(item);
+      tail.store(t + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * Removes the oldest item if there is one.  Consumer thread only.
+     *
+     * @param   item   Receives the removed item
+     *
+     * @return   False if the queue is empty
+     */
+    bool try_pop(T& item)
+    {
+      std::size_t h = head.load(std::memory_order_relaxed);
+      if (h == tail.load(std::memory_order_acquire)) {
+        return false;
+      }
+      item = std::move(slots[h & mask]);
+      slots[h & mask] = T();
+      head.store(h + 1, std::memory_order_release);
+      return true;
+    }
+
+    /**
+     * Adds an item, waiting for room if the queue is full.  Producer
+     * thread only.
+     *
+     * @param   item   Item to move into the queue
+     *
+     * @return   False if the queue was closed, in which case item is
+     *           left untouched
+     */
+    bool push(T&& item)
+    {
+      for (unsigned int spins=0; ; ++spins) {
+        if (closed.load(std::memory_order_acquire)) {
+          return false;
+        }
+        if (try_push(std::move(item))) {
+          return true;
+        }
+        backoff(spins);
+      }
+    }
+
+    /**
+     * Removes the oldest item, waiting for one if the queue is empty.
+     * Consumer thread only.
+     *
+     * @param   item   Receives the removed item
+     *
+     * @return   False if the queue is closed and empty
+     */
+    bool pop(T& item)
+    {
+      for (unsigned int spins=0; ; ++spins) {
+        if (try_pop(item)) {
+          return true;
+        }
+        if (closed.load(std::memory_order_acquire)) {
+          return try_pop(item);
+        }
+        backoff(spins);
+      }
+    }
+
+    /**
+     * Rejects further pushes and releases waiting threads.  Items
+     * already queued may still be popped.  May be called from any
+     * thread.
+     */
+    void close() { closed.store(true, std::memory_order_release); }
+
+    /** @return   True once close() has been called */
+    bool is_closed() const { return closed.load(std::memory_order_acquire); }
+
+    /**
+     * @return   Number of queued items.  Only the producer can rely on
+     *           it not growing and only the consumer on it not
+     *           shrinking.
+     */
+    std::size_t size() const
+    {
+      std::size_t h = head.load(std::memory_order_acquire);
+      return tail.load(std::memory_order_acquire) - h;
+    }
+
+    /** @return   Maximum number of queued items */
+    std::size_t capacity() const { return mask + 1; }
+
+  private:
+    std::vector<T> slots;
+    std::size_t mask {0};
+      // Counters on separate cache lines so the two sides don't contend
+    alignas(64) std::atomic<std::size_t> head {0};    // Next to pop
+    alignas(64) std::atomic<std::size_t> tail {0};    // Next to push
+    std::atomic<bool> closed {false};
+
+    static void backoff(unsigned int spins)
+    {
+      if (spins < 64) {
+        return;
+      } else if (spins < 128) {
+        std::this_thread::yield();
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+      }
+    }
+};
+
+#endif  // UTL_SPSC_QUEUE_H
@@ -0,0 +1,114 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef UTL_THREAD_POOL_H
+#define UTL_THREAD_POOL_H
+
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <deque>
+#include <vector>
+
+/**
+ * A fixed size pool of worker threads with a task queue per worker.
+ * Tasks submitted by a worker go to its own queue, where it takes the
+ * most recently added first, and tasks submitted from other threads are
+ * spread across the queues in turn.  A worker whose queue is empty steals
+ * the oldest task from another worker's queue, so the pool stays busy
+ * when shared by several independent callers without every submission
+ * contending for a single lock.  Tasks are fire and forget - callers
+ * needing to know when work is complete must provide their own
+ * signaling.  Worker threads are joined when the pool is destroyed,
+ * after all queued tasks have run.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class ThreadPool {
+  public:
+    /**
+     * Start worker threads.
+     *
+     * @param   nthreads   Number of worker threads.  If zero, the number
+     *                     of hardware threads is used (minimum of one).
+     */
+    explicit ThreadPool(unsigned int nthreads = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Runs any remaining tasks and then joins all worker threads.
+     */
+    ~ThreadPool();
+
+    /** @return   Number of worker threads */
+    unsigned int size() const
+    {
+      return static_cast<unsigned int>(workers.size());
+    }
+
+    /**
+     * Queue a task for execution by the next available worker.  Tasks
+     * should not throw - any escaping exception is discarded.
+     *
+     * @param   task   Work to perform
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Splits the index range [0, n) into chunks of at most grain indices
+     * and processes them concurrently.  The calling thread takes part in
+     * the work and does not return until every chunk is complete, so this
+     * may safely be called from within a task already running on this
+     * pool.  Chunks are claimed in increasing order, but may complete in
+     * any order.
+     *
+     * @param   n      Number of indices to process
+     * @param   grain  Maximum number of indices per chunk
+     * @param   fn     Function called with the first index and number
+     *                 of indices of each chunk
+     *
+     * @throws   The first exception thrown by fn, once all chunks are
+     *           complete.
+     */
+    void parallel_for(std::size_t n, std::size_t grain,
+                    const std::function<void(std::size_t, std::size_t)>& fn);
+
+  private:
+    struct TaskQueue {
+      std::mutex mtx;
+      std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<TaskQueue>> queues;   // Per worker
+    std::atomic<std::size_t> next_queue {0};  // For outside submissions
+    std::atomic<std::size_t> pending {0};     // Queued, not yet taken
+    std::atomic<unsigned int> nsleeping {0};
+    std::mutex mtx;                           // Guards sleep/stopping
+    std::condition_variable cv;
+    bool stopping {false};
+
+    /**
+     * @param   ndx    Worker looking for a task
+     * @param   task   Receives the task taken
+     *
+     * @return   False if every queue was empty
+     */
+    bool take(std::size_t ndx, std::function<void()>& task);
+
+    void run(std::size_t ndx);
+};
+
+#endif  // UTL_THREAD_POOL_H
@@ -0,0 +1,111 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef VMSAT_BATCH_H
+#define VMSAT_BATCH_H
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <utl_thread_pool.h>
+#include <astro_table_cache.h>
+
+/**
+ * Runs many case files within a single process.  Several cases run at
+ * once, each taking the next case file not yet started, and all cases
+ * execute their functions on one shared thread pool, so threads are
+ * created once rather than per case.  Leap second and EOP tables named
+ * by several cases are likewise loaded once and shared (see
+ * AstroTableCache).  The readable output of each case is buffered and
+ * written in case file order, each preceded by a "==> file <==" line, as
+ * soon as it and every case before it are finished.  A summary with the time taken by each case and the reason
+ * for any failure follows the output of the last case.
+ * <P>
+ * Files named after function labels are written to the current
+ * directory, so cases run in the same batch should use distinct labels
+ * for file output.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class VmsatBatch {
+  public:
+    /**
+     * @param   case_files   Names of case files, in output order
+     * @param   nthreads     Number of threads in the shared pool.  If
+     *                       zero, the number of hardware threads is used.
+     */
+    explicit VmsatBatch(const std::vector<std::string>& case_files,
+                        unsigned int nthreads = 0);
+
+    /**
+     * Reads case file names from a manifest, one per line.  Blank lines
+     * and lines starting with '#' are skipped, as is leading and trailing
+     * whitespace.
+     *
+     * @param   manifest   Name of manifest file
+     *
+     * @return   Case file names, in manifest order
+     *
+     * @throws   runtime_error if the manifest can't be read
+     */
+    static std::vector<std::string> read_manifest(
+                                               const std::string& manifest);
+
+    /**
+     * Runs every case, writing the output of each in order.
+     *
+     * @param   out   Destination for case output and the summary
+     *
+     * @return   Number of cases that failed to parse or run
+     */
+    int run(std::ostream& out);
+
+    /**
+     * @param   out   Destination for the time taken by the batch and by
+     *                each case, along with any failures
+     */
+    void summary(std::ostream& out) const;
+
+  private:
+    struct CaseResult {
+      std::string output;                   // Until written
+      double seconds {0.0};
+      bool done {false};
+      bool ok {false};
+      std::string error;                    // Reason for failure
+    };
+
+    std::vector<std::string> files;
+    std::shared_ptr<ThreadPool> pool;
+    std::shared_ptr<AstroTableCache> tables;
+    std::vector<CaseResult> results;
+    double batch_seconds {0.0};
+      // Output of cases finished out of order is held until its turn
+    std::mutex out_mtx;
+    std::size_t next_out {0};
+
+    /**
+     * @param   ndx   Case to parse and run, buffering its output
+     */
+    void run_case(std::size_t ndx);
+
+    /**
+     * Writes the output of each finished case whose predecessors have
+     * all been written.  out_mtx must be held.
+     *
+     * @param   out   Destination for case output
+     */
+    void write_ready(std::ostream& out);
+};
+
+#endif  // VMSAT_BATCH_H
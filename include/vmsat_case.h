@@ -9,15 +9,31 @@
 #ifndef VMSAT_CASE_H
 #define VMSAT_CASE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <iostream>
+#include <istream>
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <map>
+#include <utility>
 #include <vector>
 
 #include <comp_isimulation.h>
 #include <comp_ifunction.h>
+#include <comp_time_grid.h>
+#include <comp_label_registry.h>
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
+#include <astro_leap_sec.h>
+#include <astro_ut1mutc.h>
+#include <astro_table_cache.h>
+#include <utl_thread_pool.h>
+#include <utl_case_tokenizer.h>
 
 /**
  * Keywords associated with inputs related to configuring a case file
@@ -26,7 +42,12 @@ enum class CaseKeyWord {
   NONE,                           // Do nothing keyword
   COMPUTE,                        // Use definitions to compute something
   SIMSTART,                       // Simulation start time
-  SIMDAYS                         // Simulation duration
+  SIMDAYS,                        // Simulation duration
+  LEAPSECFILE,                    // Leap second table file
+  EOPFILE,                        // Earth orientation parameter file
+  COMPRESS,                       // Binary output compression on/off
+  CHUNKSIZE,                      // Records per chunk, streaming mode
+  SWEEP                           // Values over which to vary the case
 };
 
 /**
@@ -36,7 +57,12 @@ const std::map<std::string,CaseKeyWord> keyword_table {
   {"None",     CaseKeyWord::NONE},
   {"Compute",  CaseKeyWord::COMPUTE},
   {"SimStart", CaseKeyWord::SIMSTART},
-  {"SimDays",  CaseKeyWord::SIMDAYS}
+  {"SimDays",  CaseKeyWord::SIMDAYS},
+  {"LeapSecFile", CaseKeyWord::LEAPSECFILE},
+  {"EopFile",  CaseKeyWord::EOPFILE},
+  {"Compress", CaseKeyWord::COMPRESS},
+  {"ChunkSize", CaseKeyWord::CHUNKSIZE},
+  {"Sweep",    CaseKeyWord::SWEEP}
 };
 
 /**
@@ -46,6 +72,23 @@ const std::map<std::string,CaseKeyWord> keyword_table {
  * is stored.  A summary of the inputs can be output to the desired stream.
  * The functions can be executed and then reports output to a stream and/or
  * .csv files.
+ * <P>
+ * Function results, streamed chunks, and time grids are allocated from a
+ * pooled arena owned by the case.  Freed blocks are recycled within the
+ * case, and everything is returned at once when the case is destroyed.
+ * <P>
+ * A case with Sweep blocks is a template for a set of variants, one for
+ * each combination of the values listed by every Sweep block.  A Sweep
+ * block lists values for the simulation start, the simulation duration,
+ * or the output rate of a labeled function:
+ * <PRE>
+ *   Sweep { SimStart 2016 3 14 0 0 0  2016 6 14 0 0 0 }
+ *   Sweep { SimDays 1 7 30 }
+ *   Sweep { Rate g82 1 0.5 }
+ * </PRE>
+ * Dates are given with all six of year, month, day, hour, minute, and
+ * second.  The last Sweep block varies fastest.  Each variant is the case
+ * with its values in place of those otherwise given.
  *
  * @author  Kurt Motekew
  * @date    20160314
@@ -53,26 +96,133 @@ const std::map<std::string,CaseKeyWord> keyword_table {
 class VmsatCase : public CompISimulation {
   public:
     /**
-     * Parses an input stream defining the case.  Instead of throwing an
-     * exception when an error is encountered, the validity flag is set to
-     * false and the location in the stream (about) where the error occured
-     * along with the offending token is recorded.  If an exception does
-     * manage to escape, then something went very wrong...
+     * Parses text defining the case.  Instead of throwing an exception
+     * when an error is encountered, the validity flag is set to false and
+     * the line and column of the entry in error along with its text are
+     * recorded.  If an exception does manage to escape, then something
+     * went very wrong...
+     *
+     * @param   text      Case definition.  Only needed during
+     *                    construction.
+     * @param   workers   Thread pool to execute functions, possibly
+     *                    shared with other cases.  If null, the case
+     *                    creates its own.
+     * @param   tables    Source of tables named by the LeapSecFile and
+     *                    EopFile keywords, possibly shared with other
+     *                    cases.  If null, tables are loaded from their
+     *                    files.
+     */
+    explicit VmsatCase(std::string_view text,
+                       const std::shared_ptr<ThreadPool>& workers = nullptr,
+                       const std::shared_ptr<AstroTableCache>& tables =
+                                                                  nullptr);
+
+    /**
+     * Parses the full contents of an input stream defining the case, as
+     * above.
      *
      * @param   Input source for case definition.
      */
     VmsatCase(std::istream&);
 
     /**
-     * Executes each requested "Compute" function.
+     * @return   Number of variants defined by Sweep blocks, or one if
+     *           there are none
+     */
+    std::size_t num_variants() const;
+
+    /**
+     * Executes each requested "Compute" function whose results are
+     * needed - those whose records are written by their report, and
+     * those feeding functions that are needed.  Others are skipped.
+     * Functions are run
+     * concurrently on a pool of worker threads, with each function
+     * started as soon as all functions it depends on have completed,
+     * earliest defined first.  Shared time grids are freed as soon as no
+     * function still to be run needs them.  A function with an input
+     * that failed, or was not run, is not run either.
+     *
+     * @throws   The first exception thrown by any function, after all
+     *           functions that can run have completed.
      */
     void execute();
 
+    /**
+     * Same as execute(), with notification as each function finishes.
+     *
+     * @param   on_done   Called from a worker thread with the location of
+     *                    each function as it finishes, and false if it
+     *                    threw an exception or was not run because an
+     *                    input failed.  Must be thread safe.
+     */
+    void execute(const std::function<void(int, bool)>& on_done);
+
     /**
      * Sends each report to appropriate outputs (outpout stream in a human
-     * readable format and/or .csv file)
+     * readable format and/or .csv file).  Skipped functions are not
+     * reported.
      */
-    void report();
+    void report() { report(std::cout); }
+
+    /**
+     * Same as report(), with readable text sent to the given stream.
+     *
+     * @param   out   Destination for readable report text
+     */
+    void report(std::ostream& out);
+
+    /**
+     * Executes all functions and reports their results, overlapping the
+     * two.  Reports are formatted by a background thread, in the order
+     * functions were defined, as soon as each function finishes, while
+     * later functions are still being computed.  Formatted output is
+     * written by a separate I/O thread through a bounded queue of
+     * buffers, capping the memory held by output waiting to be written.
+     * Once reported and consumed by its last dependent function, the
+     * results of each function are freed, so when finished results() of
+     * each function is empty.  Output is identical to execute() followed
+     * by report(), which should be used instead if results are wanted
+     * afterwards.
+     * <P>
+     * If a chunk size was given with the ChunkSize keyword, functions
+     * are instead run in streaming mode:  each function computes a chunk
+     * of records at a time, each chunk flowing through consuming
+     * functions and report outputs and then being freed.  Functions run
+     * concurrently as a pipeline, a chunk at a time on the thread pool,
+     * passing chunks to consumers through bounded lock free queues, so a
+     * consumer works on one chunk while its inputs compute the next.
+     * Memory held by results is then bounded by the chunk size and queue
+     * depth rather than the simulation duration.  Functions are started
+     * in the order defined, with only a few more than the pool has
+     * threads in progress at once.  Report text of a function started
+     * before all earlier ones finish is spooled to a temporary file so
+     * output is in the same order as otherwise.  Streaming applies only
+     * if every function supports it.  When finished, results() of each
+     * function is empty.
+     * <P>
+     * If the case has Sweep blocks, each variant is instead run as a
+     * separate case, several at once on the same thread pool, sharing
+     * the leap second and EOP tables of this case.  Output of each
+     * variant is headed by its values and written in variant order.
+     * Files are written only for functions requesting them, with the
+     * variant number appended to the label.  Functions of this case are
+     * not executed.
+     *
+     * @throws   The first exception thrown by any function, after
+     *           reporting all functions defined before it.  For a sweep,
+     *           the first exception in variant order, after all variants
+     *           have been run.
+     */
+    void run() { run(std::cout); }
+
+    /**
+     * Same as run(), with readable text sent to the given stream.
+     *
+     * @param   out   Destination for readable report text
+     *
+     * @throws   See run()
+     */
+    void run(std::ostream& out);
 
     /** @return  Simulation start time */
     virtual JulianDate startJD() const;
@@ -80,9 +230,34 @@ class VmsatCase : public CompISimulation {
     /** @return  Simulation period in days */
     virtual double simDays() const;
 
+    /** @return  Worker threads used to execute this case */
+    virtual ThreadPool* threadPool() const;
+
+    /**
+     * @return  Leap second table loaded with the LeapSecFile keyword, or
+     *          the built in table
+     */
+    virtual const LeapSec& leapSec() const;
+
+    /**
+     * @return  UT1 - UTC table loaded with the EopFile keyword, or a table
+     *          returning zero if none was given
+     */
+    virtual const UT1mUTC& ut1mUtc() const;
+
+    /**
+     * @return  Uniform time grid, created on first request and shared by
+     *          all functions of this case requesting the same grid
+     */
+    virtual std::shared_ptr<const CompTimeGrid>
+                                timeGrid(const ExactTime& start,
+                                         std::int64_t step_ns,
+                                         std::size_t count) const;
+
     /**
      * This summary of the case is meant to verify the input stream was
-     * properly interpreted.
+     * properly interpreted.  Functions that will be skipped because
+     * their results are neither reported nor used are listed.
      *
      * @return   Summary info about this case
      */
@@ -93,33 +268,113 @@ class VmsatCase : public CompISimulation {
      */
     void to_stream(std::ostream& os);
 
-    /** @return   Stream location at beginning of case description */
-    std::streampos case_start() const { return case_pos0; }
+    /**
+     * Keeps binary output in memory rather than writing files, for
+     * retrieval with binary_output() once run.  Applies to every
+     * variant of a sweep.  Must be called before running.
+     */
+    void capture_binary();
+
+    /**
+     * @return   Name of the file each binary output would have been
+     *           written to, and its contents, by variant and then
+     *           function.  Empty unless capture_binary() was
+     *           called.  Functions with no records to report have none.
+     */
+    std::vector<std::pair<std::string, std::string>> binary_output() const;
 
     /** @return   If true, no errors were encountered parsing the case */
     bool is_valid() const { return valid; }
 
-    /** @return   Stream location after last valid entry */
-    std::streampos err_start() const { return err_pos0; }
+    /** @return   Line, starting at one, of the entry in error */
+    int err_line() const { return err_ln; }
 
-    /** @return   Stream location after beginning of error */
-    std::streampos err_stop()  const { return err_pos; }
+    /** @return   Column, starting at one, of the entry in error */
+    int err_column() const { return err_col; }
 
-    /** @return   Token associated with input error */
-    std::string err_token() const { return etoken; }
+    /**
+     * @return   Case text from the start of the entry in error through
+     *           the token at which the error was detected
+     */
+    std::string err_text() const { return err_str; }
 
   private:
+      // Chunks each streaming function may run ahead of its consumers
+    static constexpr std::size_t STREAM_DEPTH {4};
+      // Estimated report text per record, and smallest output buffer,
+      // for sizing streaming output buffers to a chunk
+    static constexpr std::size_t STREAM_LINE_BYTES {128};
+    static constexpr std::size_t STREAM_MIN_BUFSIZE {1 << 12};
+
+      // Case input varied by a Sweep block
+    enum class SweepParam { SIMSTART, SIMDAYS, RATE };
+
+      // Values for one Sweep block
+    struct SweepAxis {
+      SweepParam param;
+      int loc {-1};                         // Function, if a rate
+      std::vector<std::vector<std::string>> values;   // Inputs per value
+    };
+
       // Error handling/reporting
     bool valid {true};
-    std::streampos case_pos0 {0};
-    std::streampos  err_pos0 {0};
-    std::streampos  err_pos  {0};
-    std::string etoken;
+    int err_ln {1};
+    int err_col {1};
+    std::size_t err_pos {0};                // Offset of entry in the text
+    std::string err_str;
+
+      // Storage for results and grids - declared ahead of its users so
+      // it is destroyed after them
+    std::pmr::synchronized_pool_resource arena;
 
       // Case data
     JulianDate sim_start_jd;
     double sim_days {1.0};
+    LeapSec leap_sec;
+    UT1mUTC ut1_utc;
+    bool compress {true};
+    std::size_t chunk_size {0};             // Zero unless streaming
     std::vector<std::unique_ptr<CompIFunction>> comp_requests;
+      // For each function, locations of functions consuming its results
+    std::vector<std::vector<int>> comp_dependents;
+      // Labels of functions available as inputs
+    CompLabelRegistry comp_labels;
+    std::shared_ptr<ThreadPool> pool;
+    std::shared_ptr<AstroTableCache> table_cache;
+    std::shared_ptr<CompTimeGridCache> grid_cache;
+      // Sweep definitions and the case text from which variants are
+      // parsed, kept only if sweeping
+    const VmsatCase* sweep_tmpl {nullptr};  // Case this is a variant of
+    std::vector<SweepAxis> sweeps;
+    std::string case_text;
+      // Captured binary output, named by file, if capturing.  Sized once
+      // so functions may hold pointers to the contents.
+    bool capture_bin {false};
+    std::vector<std::pair<std::string, std::string>> bin_output;
+
+   /**
+    * Parses a variant of a case with Sweep blocks, sharing its thread
+    * pool and tables.  Sweep blocks are ignored.
+    *
+    * @param   tmpl   Case with Sweep blocks, to outlive the variant
+    * @param   ndx    Zero based variant, less than tmpl.num_variants()
+    */
+    VmsatCase(const VmsatCase& tmpl, std::size_t ndx);
+
+   /**
+    * Parses keyword blocks, see VmsatCase(std::string_view, ...)
+    *
+    * @param   text   Case definition
+    */
+    void parse(std::string_view text);
+
+   /**
+    * Marks the case invalid, recording the text of the entry in error.
+    *
+    * @param   tokens   Tokenizer having just read the token at which the
+    *                   error was detected
+    */
+    void parse_error(const CaseTokenizer& tokens);
 
    /**
     * @param   ndx      Keyword type to parse
@@ -130,6 +385,63 @@ class VmsatCase : public CompISimulation {
     */
     void parse_keyword_block(CaseKeyWord ndx,
                              const std::vector<std::string>& inputs);
+
+   /**
+    * @param   inputs   Inputs of a Sweep block, the first naming the
+    *                   value to vary
+    *
+    * @throws  std::invalid_argument
+    */
+    void add_sweep(const std::vector<std::string>& inputs);
+
+   /**
+    * @param   ndx   Zero based variant
+    *
+    * @return   For each Sweep block, in order, the index of the value
+    *           used by the variant
+    */
+    std::vector<std::size_t> variant_values(std::size_t ndx) const;
+
+   /**
+    * @param   ndx   Zero based variant
+    *
+    * @return   Appended to labels to name the files of the variant
+    */
+    static std::string variant_suffix(std::size_t ndx);
+
+   /**
+    * @param   ndx   Zero based variant
+    *
+    * @return   Values used by the variant, as given in the case
+    */
+    std::string variant_str(std::size_t ndx) const;
+
+   /**
+    * Runs and reports each variant, see run().
+    *
+    * @param   out   Destination for readable report text
+    */
+    void run_sweep(std::ostream& out);
+
+   /**
+    * Adds the most recently created function to the dependency graph,
+    * and registers its label if labeled for use by other functions.
+    */
+    void add_to_graph();
+
+   /**
+    * @return   For each function, true if its records are written by its
+    *           report or it feeds a function that is needed
+    */
+    std::vector<bool> needed() const;
+
+   /**
+    * Runs all functions as a pipeline, a chunk of records at a time, see
+    * run().
+    *
+    * @param   out   Destination for readable report text
+    */
+    void stream(std::ostream& out);
 };
 
 
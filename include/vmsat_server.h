@@ -0,0 +1,103 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef VMSAT_SERVER_H
+#define VMSAT_SERVER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include <utl_thread_pool.h>
+#include <astro_table_cache.h>
+
+/**
+ * Long lived server evaluating cases sent to it, keeping warm between
+ * requests what is costly to set up for each:  the worker threads, and
+ * leap second and EOP tables (see AstroTableCache).  Requests are read
+ * from a file descriptor such as standard input, or from connections to
+ * a Unix domain socket, each connection served by its own thread sharing
+ * the same pool and tables.  Requests on a connection are answered in
+ * order.
+ * <P>
+ * A request is a line giving the length of the case text and the format
+ * of the result, followed by the case text itself:
+ * <PRE>
+ *   Case nbytes [text|binary]
+ * </PRE>
+ * A line reading "Quit" ends the session, as does the end of input.
+ * Each response starts with the line
+ * <PRE>
+ *   Result status microseconds nbytes nfiles
+ * </PRE>
+ * where status is ok, invalid (error in the case text), failed (error
+ * running the case), or bad (malformed request, ending the session), and
+ * microseconds is the time taken to parse, run, and report the case.
+ * The line is followed by nbytes of readable output, or the reason if
+ * not ok.  With the binary format, binary output of the case (see
+ * CompBinaryWriter) is kept in memory rather than written to files, and
+ * the contents of each file it would have written follow as the line
+ * <PRE>
+ *   File name nbytes
+ * </PRE>
+ * and the file contents.  Otherwise, files requested by the case are
+ * written to the working directory of the server, so requests served at
+ * once on different connections should use distinct labels for them.
+ * <P>
+ * SIGPIPE is ignored once a server is created, so a client going away
+ * ends only its own session.
+ *
+ * @author  Kurt Motekew
+ * @date    20161017
+ */
+class VmsatServer {
+  public:
+    /**
+     * @param   nthreads   Number of threads in the shared pool.  If zero,
+     *                     the number of hardware threads is used.
+     */
+    explicit VmsatServer(unsigned int nthreads = 0);
+
+    /**
+     * Serves a single session, answering requests until the input ends
+     * or "Quit" is read.
+     *
+     * @param   in_fd    Source of requests
+     * @param   out_fd   Destination for responses
+     *
+     * @return   Number of requests answered
+     */
+    std::size_t serve(int in_fd, int out_fd);
+
+    /**
+     * Serves connections to a Unix domain socket, replacing any file
+     * existing at its path, until accepting a connection fails.
+     *
+     * @param   path   Socket file name
+     *
+     * @throws   runtime_error if the socket can't be created, or once
+     *           accepting fails, after open sessions end
+     */
+    void listen(const std::string& path);
+
+  private:
+    std::shared_ptr<ThreadPool> pool;
+    std::shared_ptr<AstroTableCache> tables;
+
+    /**
+     * @param   text     Case definition
+     * @param   binary   If true, binary files written by the case are
+     *                   included in the response
+     *
+     * @return   Complete response
+     */
+    std::string evaluate(std::string_view text, bool binary) const;
+};
+
+#endif  // VMSAT_SERVER_H
@@ -0,0 +1,45 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstdint>
+#include <cmath>
+
+#include <astro_julian_date.h>
+#include <astro_exact_time.h>
+
+constexpr std::int64_t ExactTime::NS_PER_SEC;
+constexpr std::int64_t ExactTime::NS_PER_MIN;
+constexpr std::int64_t ExactTime::NS_PER_DAY;
+constexpr std::int64_t ExactTime::MAX_DAYS;
+
+/*
+ * The whole day is taken from the high part alone so no precision is lost
+ * to the large magnitude of a full Julian Date.  What is left of the high
+ * part is combined with the low part before scaling to nanoseconds.
+ */
+ExactTime::ExactTime(const JulianDate& jd)
+{
+  double hi = jd.jdHiVal() - JulianDate::MJD;
+  double whole = std::floor(hi);
+  double frac = (hi - whole) + jd.jdLowVal();
+  day = static_cast<std::int64_t>(whole);
+  ns = ns_from_days(frac);
+  normalize();
+}
+
+
+std::int64_t ExactTime::ns_from_days(double days)
+{
+  return std::llround(days*static_cast<double>(NS_PER_DAY));
+}
+
+
+std::int64_t ExactTime::ns_from_minutes(double minutes)
+{
+  return std::llround(minutes*static_cast<double>(NS_PER_MIN));
+}
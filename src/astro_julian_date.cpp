@@ -91,9 +91,9 @@ double JulianDate::jdLowVal() const
 double JulianDate::mjd() const
 {
   if (jdSec == 0.0) {
-    return DAY_PER_MIN*jdLow + (jdHi - MJD);
+    return jdLow + (jdHi - MJD);
   } else {
-    return DAY_PER_SEC*jdSec + DAY_PER_MIN*jdLow + (jdHi - MJD);
+    return DAY_PER_SEC*jdSec + jdLow + (jdHi - MJD);
   }
 }
 
@@ -6,10 +6,23 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
 #include <astro_leap_sec.h>
 
-constexpr static int NLEAP {27};
+constexpr static int NLEAP {28};
 constexpr static int taimutc[NLEAP] =
 {
   10,  //  1
@@ -38,10 +51,11 @@ constexpr static int taimutc[NLEAP] =
   33,  // 24
   34,  // 25
   35,  // 26
-  36   // 27
+  36,  // 27
+  37   // 28
 };
 constexpr static double jd_vals[NLEAP] =
-{                                       
+{
   2441317.5,
   2441500.5,
   2441683.5,
@@ -68,32 +82,190 @@ constexpr static double jd_vals[NLEAP] =
   2453736.5,
   2454832.5,
   2456109.5,
-  2457204.5
+  2457204.5,
+  2457754.5
 };
 
+  // NTP timestamps (leap-seconds.list) count seconds from 1900-01-01
+constexpr static std::int64_t NTP_EPOCH_MJD {15020};
+constexpr static std::int64_t SEC_PER_DAY {86400};
 
-double LeapSec::taiMutc(double jd) const
+/*
+ * Whole MJD day number of a scalar Julian Date.  Leap seconds take effect
+ * at the start of a UTC day, so the day number is all that is needed.
+ */
+static std::int64_t mjd_day(double jd)
+{
+  return static_cast<std::int64_t>(std::floor(jd - JulianDate::MJD));
+}
+
+
+LeapSec::LeapSec()
+{
+  static const std::shared_ptr<const std::vector<Entry>> builtin = [] {
+    std::shared_ptr<std::vector<Entry>> tbl =
+                                      std::make_shared<std::vector<Entry>>();
+    for (int ii=0; ii<NLEAP; ++ii) {
+      tbl->push_back({mjd_day(jd_vals[ii]),
+                      static_cast<double>(taimutc[ii])});
+    }
+    return tbl;
+  }();
+  table = builtin;
+}
+
+
+/*
+ * USNO tai-utc.dat lines look like
+ *   1972 JAN  1 =JD 2441317.5  TAI-UTC=  10.0  S + (MJD - 41317.) X 0.0  S
+ * while leap-seconds.list lines are an NTP timestamp and offset, with
+ * comments starting with '#'.  Pre-1972 tai-utc.dat entries, which have a
+ * nonzero drift rate, are skipped.
+ */
+LeapSec::LeapSec(const std::string& filename)
 {
-  double leapsec {0.0};
-  for (int ii=(NLEAP-1); ii>=0; --ii) {
-    if (jd > jd_vals[ii]) {
-      leapsec = static_cast<int>(taimutc[ii]);
-      break;
+  std::ifstream leap_file(filename);
+  if (!leap_file.is_open()) {
+    std::cerr << "\nCan't open leap second file " << filename << '\n';
+    throw std::invalid_argument("Can't open leap second file");
+  }
+
+  std::shared_ptr<std::vector<Entry>> tbl =
+                                      std::make_shared<std::vector<Entry>>();
+  std::string line;
+  while (std::getline(leap_file, line)) {
+    std::size_t jd_pos = line.find("=JD");
+    std::size_t dat_pos = line.find("TAI-UTC=");
+    if (jd_pos != std::string::npos  &&  dat_pos != std::string::npos) {
+      double jd {0.0};
+      double dat {0.0};
+      double rate {0.0};
+      std::istringstream(line.substr(jd_pos + 3)) >> jd;
+      std::istringstream(line.substr(dat_pos + 8)) >> dat;
+      std::size_t rate_pos = line.find('X', dat_pos);
+      if (rate_pos != std::string::npos) {
+        std::istringstream(line.substr(rate_pos + 1)) >> rate;
+      }
+      if (jd > 0.0  &&  rate == 0.0) {
+        tbl->push_back({mjd_day(jd), dat});
+      }
+    } else {
+      std::size_t first = line.find_first_not_of(" \t");
+      if (first == std::string::npos  ||  line[first] == '#') {
+        continue;
+      }
+      std::istringstream iss(line);
+      std::int64_t ntp {0};
+      double dat {0.0};
+      if (iss >> ntp >> dat) {
+        tbl->push_back({NTP_EPOCH_MJD + ntp/SEC_PER_DAY, dat});
+      }
     }
   }
-  return leapsec;
+
+  if (tbl->empty()) {
+    std::cerr << "\nNo leap seconds found in " << filename << '\n';
+    throw std::invalid_argument("Invalid leap second file");
+  }
+  std::sort(tbl->begin(), tbl->end(),
+            [](const Entry& a, const Entry& b) { return a.mjd < b.mjd; });
+  table = tbl;
+}
+
+
+/*
+ * @return   Number of table entries in effect on the given day - one past
+ *           the location of the applicable entry.
+ */
+std::size_t LeapSec::locate(std::int64_t mjd) const
+{
+  auto itr = std::upper_bound(table->begin(), table->end(), mjd,
+                              [](std::int64_t day, const Entry& e) {
+                                return day < e.mjd;
+                              });
+  return static_cast<std::size_t>(itr - table->begin());
+}
+
+
+double LeapSec::value(std::size_t loc) const
+{
+  return (loc == 0) ? 0.0 : (*table)[loc - 1].taimutc;
+}
+
+
+double LeapSec::taiMutc(double jd) const
+{
+  return value(locate(mjd_day(jd)));
 }
 
 
 double LeapSec::taiMutc(const JulianDate& jdc) const
 {
-  double jd {jdc.jd()};
-  double leapsec {0.0};
-  for (int ii=(NLEAP-1); ii>=0; --ii) {
-    if (jd > jd_vals[ii]) {
-      leapsec = static_cast<int>(taimutc[ii]);
-      break;
+  return taiMutc(jdc.jd());
+}
+
+
+double LeapSec::taiMutc(const ExactTime& et, std::size_t& cursor) const
+{
+  std::int64_t mjd = et.mjd_day();
+  std::size_t n = table->size();
+  if (cursor > n) {
+    cursor = 0;
+  }
+  auto in_effect = [&](std::size_t loc) {
+    return (loc == 0  ||  (*table)[loc - 1].mjd <= mjd)  &&
+           (loc == n  ||  mjd < (*table)[loc].mjd);
+  };
+  if (!in_effect(cursor)) {
+    if (cursor < n  &&  in_effect(cursor + 1)) {
+      cursor++;
+    } else {
+      cursor = locate(mjd);
+    }
+  }
+  return value(cursor);
+}
+
+
+std::vector<LeapSec::Segment> LeapSec::segments(const ExactTime& start,
+                                                std::int64_t step_ns,
+                                                std::size_t count) const
+{
+  std::vector<Segment> segs;
+  std::size_t n = table->size();
+  std::size_t ndx {0};
+  while (ndx < count) {
+    ExactTime et_now = start + static_cast<std::int64_t>(ndx)*step_ns;
+    std::size_t loc = locate(et_now.mjd_day());
+    std::size_t end = count;
+    if (loc < n) {
+        // First grid point at or after the next leap second
+      ExactTime boundary((*table)[loc].mjd, 0);
+      std::int64_t ns_to_boundary = boundary - start;
+      std::int64_t next = (ns_to_boundary + step_ns - 1)/step_ns;
+      if (next < static_cast<std::int64_t>(count)) {
+        end = static_cast<std::size_t>(next);
+      }
+    }
+    segs.push_back({ndx, end - ndx, value(loc)});
+    ndx = end;
+  }
+  return segs;
+}
+
+
+std::vector<LeapSec::Segment> LeapSec::segments(const ExactTime& epoch,
+                                                const std::int64_t* offsets,
+                                                std::size_t count) const
+{
+  std::vector<Segment> segs;
+  std::size_t cursor {0};
+  for (std::size_t ii=0; ii<count; ++ii) {
+    double dat = taiMutc(epoch + offsets[ii], cursor);
+    if (segs.empty()  ||  segs.back().taimutc != dat) {
+      segs.push_back({ii, 0, dat});
     }
+    segs.back().count++;
   }
-  return leapsec;
+  return segs;
 }
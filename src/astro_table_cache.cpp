@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <sys/stat.h>
+
+#include <astro_leap_sec.h>
+#include <astro_ut1mutc.h>
+#include <astro_table_cache.h>
+
+/*
+ * Tables are loaded with the lock held so concurrent requests for a
+ * file not yet loaded wait for a single load rather than each reading
+ * the file.  Loads are rare, and lookups of loaded tables are brief.
+ */
+LeapSec AstroTableCache::leap_sec(const std::string& filename)
+{
+  Stamp now = stamp(filename);
+  std::lock_guard<std::mutex> lock(mtx);
+  auto entry = leap_tables.find(filename);
+  if (entry != leap_tables.end()  &&  entry->second.stamp == now) {
+    return entry->second.table;
+  }
+  LeapSec table(filename);
+  ++nloads;
+  leap_tables[filename] = {now, table};
+  return table;
+}
+
+
+UT1mUTC AstroTableCache::ut1_utc(const std::string& filename)
+{
+  Stamp now = stamp(filename);
+  std::lock_guard<std::mutex> lock(mtx);
+  auto entry = eop_tables.find(filename);
+  if (entry != eop_tables.end()  &&  entry->second.stamp == now) {
+    return entry->second.table;
+  }
+  UT1mUTC table(filename);
+  ++nloads;
+  eop_tables[filename] = {now, table};
+  return table;
+}
+
+
+std::size_t AstroTableCache::loads() const
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  return nloads;
+}
+
+
+AstroTableCache::Stamp AstroTableCache::stamp(const std::string& filename)
+{
+  Stamp file_stamp;
+  struct stat file_stat;
+  if (stat(filename.c_str(), &file_stat) == 0) {
+    file_stamp.size = static_cast<long long>(file_stat.st_size);
+    file_stamp.mtime_ns =
+             1000000000LL*static_cast<long long>(file_stat.st_mtim.tv_sec) +
+             static_cast<long long>(file_stat.st_mtim.tv_nsec);
+  }
+  return file_stamp;
+}
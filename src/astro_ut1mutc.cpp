@@ -6,16 +6,284 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
 #include <astro_ut1mutc.h>
 
+/*
+ * Binary table layout:  header followed by count (mjd, ut1mutc) pairs in
+ * native byte order.  The source file size and modification time are
+ * recorded so a stale table is rebuilt.
+ */
+constexpr static char CACHE_MAGIC[8] {'V','M','S','A','T','E','O','P'};
+constexpr static std::uint32_t CACHE_ORDER {0x01020304};
+constexpr static std::uint32_t CACHE_VERSION {1};
+
+struct CacheHeader {
+  char magic[8];
+  std::uint32_t order;
+  std::uint32_t version;
+  std::int64_t src_size;
+  std::int64_t src_mtime;
+  std::uint64_t count;
+};
+
+/*
+ * finals2000A:  MJD in columns 8-15, Bulletin A UT1-UTC flag (I or P) in
+ * column 58 and value in columns 59-68.  The flag is blank past the end of
+ * the predictions.
+ */
+static bool parse_finals(const std::string& line, double& mjd, double& dut1)
+{
+  if (line.size() < 68  ||  line[12] != '.'  ||
+      (line[57] != 'I'  &&  line[57] != 'P')) {
+    return false;
+  }
+  std::istringstream mjd_ss(line.substr(7, 8));
+  std::istringstream dut_ss(line.substr(58, 10));
+  return static_cast<bool>(mjd_ss >> mjd)  &&
+         static_cast<bool>(dut_ss >> dut1);
+}
+
+
+/*
+ * EOP C04 14:  YR MM DD MJD x y UT1-UTC ...
+ * EOP C04 20:  YR MM DD HH MJD x y UT1-UTC ...
+ * The newer form is recognized by the two digit hour preceding the MJD.
+ */
+static bool parse_c04(const std::string& line, double& mjd, double& dut1)
+{
+  std::istringstream iss(line);
+  std::vector<std::string> tokens;
+  std::string tok;
+  while (iss >> tok) {
+    tokens.push_back(tok);
+  }
+  if (tokens.size() < 7  ||
+      tokens[0].find_first_not_of("0123456789") != std::string::npos) {
+    return false;
+  }
+  std::size_t mjd_ndx {3};
+  if (tokens.size() >= 8  &&  tokens[3].size() <= 2) {
+    mjd_ndx = 4;
+  }
+  std::istringstream mjd_ss(tokens[mjd_ndx]);
+  std::istringstream dut_ss(tokens[mjd_ndx + 3]);
+  return static_cast<bool>(mjd_ss >> mjd)  &&
+         static_cast<bool>(dut_ss >> dut1)  &&  mjd > 0.0;
+}
+
+
+UT1mUTC::UT1mUTC(const std::string& filename)
+{
+  struct stat src_stat;
+  if (stat(filename.c_str(), &src_stat) != 0) {
+    std::cerr << "\nCan't open EOP file " << filename << '\n';
+    throw std::invalid_argument("Can't open EOP file");
+  }
+  long long src_size = static_cast<long long>(src_stat.st_size);
+  long long src_mtime = static_cast<long long>(src_stat.st_mtime);
+  std::string cache_name = filename + ".bin";
+  if (map_cache(cache_name, src_size, src_mtime)) {
+    return;
+  }
+
+  std::ifstream eop_file(filename);
+  if (!eop_file.is_open()) {
+    std::cerr << "\nCan't open EOP file " << filename << '\n';
+    throw std::invalid_argument("Can't open EOP file");
+  }
+  std::shared_ptr<std::vector<Node>> tbl =
+                                       std::make_shared<std::vector<Node>>();
+  std::string line;
+  while (std::getline(eop_file, line)) {
+    double mjd {0.0};
+    double dut1 {0.0};
+    if (parse_finals(line, mjd, dut1)  ||  parse_c04(line, mjd, dut1)) {
+      tbl->push_back({mjd, dut1});
+    }
+  }
+  if (tbl->empty()) {
+    std::cerr << "\nNo UT1-UTC values found in " << filename << '\n';
+    throw std::invalid_argument("Invalid EOP file");
+  }
+  std::stable_sort(tbl->begin(), tbl->end(),
+                   [](const Node& a, const Node& b) { return a.mjd < b.mjd; });
+  tbl->erase(std::unique(tbl->begin(), tbl->end(),
+                         [](const Node& a, const Node& b) {
+                           return a.mjd == b.mjd;
+                         }), tbl->end());
+  nodes = tbl->data();
+  nnodes = tbl->size();
+  data = tbl;
+
+    // Failing to save the binary table only costs a reparse next time.
+    // Each writer uses its own temporary file, so concurrent loads of the
+    // same file within or across processes don't collide.
+  CacheHeader hdr;
+  std::memcpy(hdr.magic, CACHE_MAGIC, sizeof(hdr.magic));
+  hdr.order = CACHE_ORDER;
+  hdr.version = CACHE_VERSION;
+  hdr.src_size = src_size;
+  hdr.src_mtime = src_mtime;
+  hdr.count = nnodes;
+  std::vector<char> tmp_name(cache_name.begin(), cache_name.end());
+  const char suffix[] = ".XXXXXX";
+  tmp_name.insert(tmp_name.end(), suffix, suffix + sizeof(suffix));
+  int fd = mkstemp(tmp_name.data());
+  std::FILE* fp {nullptr};
+  if (fd >= 0) {
+    fchmod(fd, 0644);
+    fp = fdopen(fd, "wb");
+    if (fp == nullptr) {
+      close(fd);
+      std::remove(tmp_name.data());
+    }
+  }
+  if (fp != nullptr) {
+    bool ok = std::fwrite(&hdr, sizeof(hdr), 1, fp) == 1  &&
+              std::fwrite(nodes, sizeof(Node), nnodes, fp) == nnodes;
+    ok = (std::fclose(fp) == 0)  &&  ok;
+    if (!ok  ||  std::rename(tmp_name.data(), cache_name.c_str()) != 0) {
+      std::remove(tmp_name.data());
+    }
+  }
+}
+
+
+/*
+ * @return   true if a current binary table was found and mapped
+ */
+bool UT1mUTC::map_cache(const std::string& cache_name,
+                        long long src_size, long long src_mtime)
+{
+  int fd = open(cache_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat cache_stat;
+  if (fstat(fd, &cache_stat) != 0  ||
+      static_cast<std::size_t>(cache_stat.st_size) < sizeof(CacheHeader)) {
+    close(fd);
+    return false;
+  }
+  std::size_t len = static_cast<std::size_t>(cache_stat.st_size);
+  void* addr = mmap(nullptr, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return false;
+  }
+  std::shared_ptr<const void> mapping(addr, [len](const void* p) {
+    munmap(const_cast<void*>(p), len);
+  });
+
+  const CacheHeader* hdr = static_cast<const CacheHeader*>(addr);
+  if (std::memcmp(hdr->magic, CACHE_MAGIC, sizeof(hdr->magic)) != 0  ||
+      hdr->order != CACHE_ORDER  ||  hdr->version != CACHE_VERSION  ||
+      hdr->src_size != src_size  ||  hdr->src_mtime != src_mtime  ||
+      hdr->count == 0  ||
+      len != sizeof(CacheHeader) + hdr->count*sizeof(Node)) {
+    return false;
+  }
+  nodes = reinterpret_cast<const Node*>(static_cast<const char*>(addr) +
+                                        sizeof(CacheHeader));
+  nnodes = static_cast<std::size_t>(hdr->count);
+  data = mapping;
+  return true;
+}
+
+
+/*
+ * A jump of more than half a second between consecutive days is a leap
+ * second, which occurs at the end of the earlier day.  Whole seconds are
+ * removed from the later value so the interpolation spans only the
+ * smooth variation in UT1.
+ */
+double UT1mUTC::interpolate(std::size_t loc, double mjd) const
+{
+  const Node& n0 = nodes[loc];
+  if (loc + 1 >= nnodes  ||  mjd <= n0.mjd) {
+    return n0.ut1mutc;
+  }
+  const Node& n1 = nodes[loc + 1];
+  double v1 = n1.ut1mutc;
+  double jump = v1 - n0.ut1mutc;
+  if (std::fabs(jump) > 0.5) {
+    v1 -= std::round(jump);
+  }
+  return n0.ut1mutc + (v1 - n0.ut1mutc)*(mjd - n0.mjd)/(n1.mjd - n0.mjd);
+}
+
+
+/*
+ * @return   Location of the last node at or before mjd, or zero if mjd
+ *           precedes the table
+ */
+std::size_t UT1mUTC::locate(double mjd) const
+{
+  const Node* itr = std::upper_bound(nodes, nodes + nnodes, mjd,
+                                     [](double day, const Node& nd) {
+                                       return day < nd.mjd;
+                                     });
+  return (itr == nodes) ? 0 : static_cast<std::size_t>(itr - nodes) - 1;
+}
+
+
 double UT1mUTC::ut1Mutc(double jd) const
 {
-  return 0.0;
+  if (nnodes == 0) {
+    return 0.0;
+  }
+  double mjd = jd - JulianDate::MJD;
+  return interpolate(locate(mjd), mjd);
 }
 
 
 double UT1mUTC::ut1Mutc(const JulianDate& jdc) const
 {
-  return 0.0;
+  if (nnodes == 0) {
+    return 0.0;
+  }
+  double mjd = (jdc.jdHiVal() - JulianDate::MJD) + jdc.jdLowVal();
+  return interpolate(locate(mjd), mjd);
+}
+
+
+double UT1mUTC::ut1Mutc(const ExactTime& et, std::size_t& cursor) const
+{
+  if (nnodes == 0) {
+    return 0.0;
+  }
+  double mjd = et.mjd();
+  auto in_interval = [&](std::size_t loc) {
+    return (loc == 0  ||  nodes[loc].mjd <= mjd)  &&
+           (loc + 1 >= nnodes  ||  mjd < nodes[loc + 1].mjd);
+  };
+  if (cursor >= nnodes  ||  !in_interval(cursor)) {
+    if (cursor + 1 < nnodes  &&  in_interval(cursor + 1)) {
+      cursor++;
+    } else {
+      cursor = locate(mjd);
+    }
+  }
+  return interpolate(cursor, mjd);
 }
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <comp_ifunction.h>
+#include <comp_series.h>
+#include <comp_time_axis.h>
+#include <astro_exact_time.h>
+#include <utl_gorilla.h>
+#include <comp_binary_writer.h>
+
+constexpr std::uint32_t CompBinaryWriter::VERSION;
+constexpr std::size_t CompBinaryWriter::ALIGN;
+
+constexpr static char MAGIC[8] {'V','M','S','A','T','C','O','L'};
+constexpr static std::size_t FIXED_HEADER {96};
+constexpr static std::size_t SWAP_BLOCK {4096};
+constexpr static std::size_t DIR_ENTRY {32};
+constexpr static std::uint32_t CODEC_RAW {0};
+constexpr static std::uint32_t CODEC_PACKED {1};
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr static bool HOST_LE {true};
+#else
+constexpr static bool HOST_LE {false};
+#endif
+
+static std::uint64_t align_up(std::uint64_t n)
+{
+  return (n + CompBinaryWriter::ALIGN - 1)/CompBinaryWriter::ALIGN*
+                                          CompBinaryWriter::ALIGN;
+}
+
+
+static void put_u64(std::vector<unsigned char>& hdr, std::size_t pos,
+                                                     std::uint64_t val)
+{
+  for (int ii=0; ii<8; ++ii) {
+    hdr[pos + ii] = static_cast<unsigned char>(val >> (8*ii));
+  }
+}
+
+
+static void put_u32(std::vector<unsigned char>& hdr, std::size_t pos,
+                                                     std::uint32_t val)
+{
+  for (int ii=0; ii<4; ++ii) {
+    hdr[pos + ii] = static_cast<unsigned char>(val >> (8*ii));
+  }
+}
+
+
+static void append_u32(std::vector<unsigned char>& hdr, std::uint32_t val)
+{
+  hdr.resize(hdr.size() + 4);
+  put_u32(hdr, hdr.size() - 4, val);
+}
+
+
+static void append_str(std::vector<unsigned char>& hdr,
+                       const std::string& str)
+{
+  append_u32(hdr, static_cast<std::uint32_t>(str.size()));
+  hdr.insert(hdr.end(), str.begin(), str.end());
+}
+
+
+static std::uint64_t le_bits(double val)
+{
+  std::uint64_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+  return bits;
+}
+
+
+CompBinaryWriter::CompBinaryWriter(const std::string& filename,
+                                   const CompIFunction& fn,
+                                   const CompTimeAxis& axis, int width,
+                                   const CompSeriesView& view,
+                                   bool compress) :
+                           CompBinaryWriter(fn, axis, width, view, compress)
+{
+  fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd >= 0) {
+    start();
+  }
+}
+
+
+CompBinaryWriter::CompBinaryWriter(std::string* dest,
+                                   const CompIFunction& fn,
+                                   const CompTimeAxis& axis, int width,
+                                   const CompSeriesView& view,
+                                   bool compress) :
+                           CompBinaryWriter(fn, axis, width, view, compress)
+{
+  mem = dest;
+  mem->clear();
+  start();
+}
+
+
+/*
+ * Lays out the header, leaving the destination to be opened
+ */
+CompBinaryWriter::CompBinaryWriter(const CompIFunction& fn,
+                                   const CompTimeAxis& axis, int width,
+                                   const CompSeriesView& view,
+                                   bool compress) :
+                           nrec{axis.size()}, ncol{width},
+                           et0{axis.epoch()}, uniform{axis.is_uniform()},
+                           packed{compress}
+{
+  std::string type = fn.type_name();
+  std::string label = fn.label();
+  int nbands = (view.width() > 0) ? view.num_bands() : 0;
+
+  hdr.assign(FIXED_HEADER, 0);
+  hdr.insert(hdr.end(), type.begin(), type.end());
+  hdr.insert(hdr.end(), label.begin(), label.end());
+  for (int band=0; band<nbands; ++band) {
+    double factor = (band < fn.num_unit_types()) ? fn.unit_factors(band) :
+                                                   1.0;
+    std::string units = (band < fn.num_unit_types()) ? fn.unit_labels(band) :
+                                                       "";
+    append_u32(hdr, static_cast<std::uint32_t>(view.band_offset(band)));
+    append_u32(hdr, static_cast<std::uint32_t>(view.band_width(band)));
+    hdr.resize(hdr.size() + 8);
+    put_u64(hdr, hdr.size() - 8, le_bits(factor));
+    append_str(hdr, units);
+  }
+
+  std::uint64_t hdr_size = align_up(hdr.size());
+  stride = align_up(8*static_cast<std::uint64_t>(nrec));
+  toff_pos = uniform ? 0 : hdr_size;
+  val_pos = hdr_size + (uniform ? 0 : stride);
+
+  std::memcpy(hdr.data(), MAGIC, sizeof(MAGIC));
+  put_u32(hdr, 8, VERSION);
+  put_u32(hdr, 12, static_cast<std::uint32_t>(hdr_size));
+  put_u64(hdr, 16, nrec);
+  put_u32(hdr, 24, static_cast<std::uint32_t>(ncol));
+  put_u32(hdr, 28, static_cast<std::uint32_t>(nbands));
+  put_u32(hdr, 32, uniform ? 1 : 0);
+  put_u32(hdr, 36, packed ? CODEC_PACKED : CODEC_RAW);
+  put_u64(hdr, 40, static_cast<std::uint64_t>(et0.mjd_day()));
+  put_u64(hdr, 48, static_cast<std::uint64_t>(et0.ns_of_day()));
+  put_u64(hdr, 56, static_cast<std::uint64_t>(uniform ? axis.step() : 0));
+  put_u64(hdr, 64, toff_pos);
+  put_u64(hdr, 72, val_pos);
+  put_u64(hdr, 80, stride);
+  put_u32(hdr, 88, static_cast<std::uint32_t>(type.size()));
+  put_u32(hdr, 92, static_cast<std::uint32_t>(label.size()));
+  hdr.resize(hdr_size, 0);
+}
+
+
+/*
+ * Compressed output is held until closed.  Otherwise the destination is
+ * sized for every record and the header written.
+ */
+void CompBinaryWriter::start()
+{
+  if (packed) {
+    if (!uniform) {
+      tcol.reset(new DodColumn());
+    }
+    vcols.assign(ncol, GorillaColumn());
+    return;
+  }
+  std::uint64_t file_size = val_pos + stride*static_cast<std::uint64_t>(ncol);
+  if (mem != nullptr) {
+    mem->assign(file_size, '\0');
+  } else if (ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+    std::cerr << "\nCan't size binary output file\n";
+    close();
+    return;
+  }
+  pwrite_all(hdr.data(), hdr.size(), 0);
+  std::vector<unsigned char>().swap(hdr);
+}
+
+
+void CompBinaryWriter::write(const CompSeriesView& view)
+{
+  std::size_t n = view.size();
+  std::size_t first = view.first();
+  if (!is_open()  ||  n == 0  ||  first + n > nrec) {
+    return;
+  }
+
+  if (packed) {
+    if (first != nenc) {
+      throw std::logic_error("Compressed binary output written out of order");
+    }
+    if (tcol != nullptr) {
+      std::vector<std::int64_t> toff(n);
+      for (std::size_t ii=0; ii<n; ++ii) {
+        toff[ii] = view.exact(ii) - et0;
+      }
+      tcol->append(toff.data(), n);
+    }
+    std::vector<double> zeros;
+    for (int jj=0; jj<ncol; ++jj) {
+      if (jj < view.width()) {
+        vcols[jj].append(view.values(jj), n);
+      } else {
+        zeros.resize(n, 0.0);
+        vcols[jj].append(zeros.data(), n);
+      }
+    }
+    nenc += n;
+    return;
+  }
+
+  if (!uniform) {
+    std::vector<std::int64_t> toff(n);
+    for (std::size_t ii=0; ii<n; ++ii) {
+      toff[ii] = view.exact(ii) - et0;
+    }
+    write_le(toff.data(), n, toff_pos + 8*first);
+  }
+  int width = std::min(ncol, view.width());
+  for (int jj=0; jj<width; ++jj) {
+    write_le(view.values(jj), n, val_pos + jj*stride + 8*first);
+  }
+}
+
+
+void CompBinaryWriter::close()
+{
+  if (packed  &&  is_open()) {
+    finish_packed();
+  }
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+  mem = nullptr;
+}
+
+
+/*
+ * Column descriptors follow the header, the time column first if not
+ * uniform.  Each column's block table and then its data follow, each
+ * aligned.  Only records actually written are counted.
+ */
+void CompBinaryWriter::finish_packed()
+{
+  std::uint64_t hdr_size = hdr.size();
+  std::uint64_t ndir = static_cast<std::uint64_t>(ncol) + (uniform ? 0 : 1);
+  toff_pos = uniform ? 0 : hdr_size;
+  val_pos = hdr_size + (uniform ? 0 : DIR_ENTRY);
+  stride = DIR_ENTRY;
+  put_u64(hdr, 16, nenc);
+  put_u64(hdr, 64, toff_pos);
+  put_u64(hdr, 72, val_pos);
+  put_u64(hdr, 80, stride);
+  pwrite_all(hdr.data(), hdr.size(), 0);
+
+  std::uint64_t pos = align_up(hdr_size + ndir*DIR_ENTRY);
+  if (tcol != nullptr) {
+    pos = write_column(tcol->bytes(), tcol->block_offsets(),
+                       DodColumn::BLOCK, pos, toff_pos);
+    tcol.reset();
+  }
+  for (int jj=0; jj<ncol; ++jj) {
+    pos = write_column(vcols[jj].bytes(), vcols[jj].block_offsets(),
+                       GorillaColumn::BLOCK, pos, val_pos + jj*stride);
+    vcols[jj].clear();
+  }
+  std::vector<unsigned char>().swap(hdr);
+}
+
+
+std::uint64_t CompBinaryWriter::write_column(
+                                   const std::vector<std::uint8_t>& data,
+                                   const std::vector<std::uint64_t>& blocks,
+                                   std::size_t block_size,
+                                   std::uint64_t pos, std::uint64_t dir_pos)
+{
+  std::vector<unsigned char> table(8*blocks.size());
+  for (std::size_t ii=0; ii<blocks.size(); ++ii) {
+    put_u64(table, 8*ii, blocks[ii]);
+  }
+  std::uint64_t table_pos = pos;
+  std::uint64_t data_pos = align_up(table_pos + table.size());
+  pwrite_all(table.data(), table.size(), table_pos);
+  pwrite_all(data.data(), data.size(), data_pos);
+
+  std::vector<unsigned char> entry(DIR_ENTRY, 0);
+  put_u64(entry, 0, data_pos);
+  put_u64(entry, 8, data.size());
+  put_u32(entry, 16, static_cast<std::uint32_t>(block_size));
+  put_u32(entry, 20, static_cast<std::uint32_t>(blocks.size()));
+  put_u64(entry, 24, table_pos);
+  pwrite_all(entry.data(), entry.size(), dir_pos);
+
+  return align_up(data_pos + data.size());
+}
+
+
+void CompBinaryWriter::pwrite_all(const void* data, std::size_t n,
+                                                    std::uint64_t pos)
+{
+  const char* ptr = static_cast<const char*>(data);
+  if (mem != nullptr) {
+    if (mem->size() < pos + n) {
+      mem->resize(pos + n, '\0');
+    }
+    std::memcpy(&(*mem)[pos], ptr, n);
+    return;
+  }
+  while (n > 0  &&  fd >= 0) {
+    ssize_t nout = pwrite(fd, ptr, n, static_cast<off_t>(pos));
+    if (nout <= 0) {
+      std::cerr << "\nError writing binary output file\n";
+      close();
+      return;
+    }
+    ptr += nout;
+    pos += static_cast<std::uint64_t>(nout);
+    n -= static_cast<std::size_t>(nout);
+  }
+}
+
+
+void CompBinaryWriter::write_le(const std::int64_t* vals, std::size_t n,
+                                                          std::uint64_t pos)
+{
+  if (HOST_LE) {
+    pwrite_all(vals, 8*n, pos);
+    return;
+  }
+  std::vector<unsigned char> block;
+  for (std::size_t ii=0; ii<n; ii+=SWAP_BLOCK) {
+    std::size_t nblk = std::min(SWAP_BLOCK, n - ii);
+    block.assign(8*nblk, 0);
+    for (std::size_t kk=0; kk<nblk; ++kk) {
+      std::uint64_t bits = static_cast<std::uint64_t>(vals[ii + kk]);
+      for (int bb=0; bb<8; ++bb) {
+        block[8*kk + bb] = static_cast<unsigned char>(bits >> (8*bb));
+      }
+    }
+    pwrite_all(block.data(), block.size(), pos + 8*ii);
+  }
+}
+
+
+void CompBinaryWriter::write_le(const double* vals, std::size_t n,
+                                                    std::uint64_t pos)
+{
+  static_assert(sizeof(double) == 8, "Binary output requires 64 bit double");
+  if (HOST_LE) {
+    pwrite_all(vals, 8*n, pos);
+    return;
+  }
+  std::vector<std::int64_t> bits(std::min(SWAP_BLOCK, n));
+  for (std::size_t ii=0; ii<n; ii+=SWAP_BLOCK) {
+    std::size_t nblk = std::min(SWAP_BLOCK, n - ii);
+    std::memcpy(bits.data(), vals + ii, 8*nblk);
+    write_le(bits.data(), nblk, pos + 8*ii);
+  }
+}
@@ -6,8 +6,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <cstddef>
+#include <cstdint>
 #include <iostream>
-#include <fstream>
+#include <memory>
+#include <memory_resource>
 #include <stdexcept>
 #include <vector>
 #include <string>
@@ -16,14 +19,21 @@
 #include <comp_ifunction.h>
 #include <comp_irecord.h>
 #include <comp_scalar.h>
+#include <comp_series.h>
+#include <comp_time_axis.h>
+#include <comp_time_grid.h>
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
 #include <std_const.h>
+#include <utl_thread_pool.h>
 #include <comp_earth_rot.h>
 
 #include <sofa.h>
 
-CompEarthRot::CompEarthRot(const std::vector<std::string>& funct_params)
-                                           : CompIFunction(CompType::EARTHROT)
+CompEarthRot::CompEarthRot(const std::vector<std::string>& funct_params,
+                           std::pmr::memory_resource* mr) :
+                                           CompIFunction(CompType::EARTHROT),
+                                           cmp_lst{mr}
 {
   int nparams = static_cast<int>(funct_params.size());
   if (nparams < 5  &&  nparams > 2) {
@@ -34,6 +44,10 @@ CompEarthRot::CompEarthRot(const std::vector<std::string>& funct_params)
       throw std::invalid_argument("Wrong number of EarthRot parameters");
     }
     dt_min = std::stod(funct_params[2]);
+    if (ExactTime::ns_from_minutes(dt_min) <= 0) {
+      std::cerr << "\nEarthRot output rate must be positive\n";
+      throw std::invalid_argument("Invalid EarthRot output rate");
+    }
     if (nparams == 4) {
       try {
         CompIFunction::report_options(funct_params[3]);
@@ -53,60 +67,125 @@ CompEarthRot::CompEarthRot(const std::vector<std::string>& funct_params)
   CompIFunction::add_unit_type(units, ufactor, offset);
 }
 
+/*
+ * Each output epoch is computed exactly from its index on an integer
+ * time grid rather than by accumulating the step size, so times do not
+ * drift and the grid can be split into chunks and filled concurrently
+ * with results identical to a serial fill.  Time scale conversions come
+ * from the simulation's shared grid for this rate.
+ */
 void CompEarthRot::execute(const CompISimulation& ci)
 {
-  JulianDate jd_now = ci.startJD();
-  JulianDate jd_stop = ci.startJD();
-  jd_stop += ci.simDays();
-  double dt_days = dt_min/1440.0;
-  std::vector<double>::size_type npts =
-                    static_cast<std::vector<double>::size_type>
-                    (1 + static_cast<int>((jd_stop - jd_now)/dt_days));
-  cmp_lst.reserve(npts);
- 
-    // Increment time until the current time exceeds the stop time
-  while (jd_stop - jd_now >= 0.0) {
-    double sval {0.0};
-    switch (er_type) {
-        // For use with the IAU 1976 Precession and 1980 Nutation models
-      case EarthRotType::GMST1982:
-        {
-          double ut1mutc = delta_ut.ut1Mutc(jd_now);
-          JulianDate jdUT1 = jd_now;
-          jdUT1 += ut1mutc*JulianDate::DAY_PER_SEC;
-          sval = iauGmst82(jdUT1.jdHiVal(), jdUT1.jdLowVal());
-        }
-        break;
-        // For use with the IAU 2000+ Equinox based theories
-      case EarthRotType::GMST2000:
-        {
-          double ut1mutc = delta_ut.ut1Mutc(jd_now);
-          JulianDate jdUT1 = jd_now;
-          jdUT1 += ut1mutc*JulianDate::DAY_PER_SEC;
-          double leapsec = delta_at.taiMutc(jd_now);
-          JulianDate jdTT = jd_now;
-          jdTT += (leapsec + 32.184)*JulianDate::DAY_PER_SEC;
-          sval = iauGmst00(jdUT1.jdHiVal(), jdUT1.jdLowVal(),
-                           jdTT.jdHiVal(),  jdTT.jdLowVal());
-        }
-        break;
+  ExactTime et_start {ci.startJD()};
+  std::int64_t dt_ns = ExactTime::ns_from_minutes(dt_min);
+  std::int64_t span_ns = ExactTime::ns_from_days(ci.simDays());
+  std::size_t npts = static_cast<std::size_t>(1 + span_ns/dt_ns);
+  std::shared_ptr<const CompTimeGrid> grid =
+                                        ci.timeGrid(et_start, dt_ns, npts);
+  CompIFunction::init_series(cmp_lst, grid->axis_ptr(), 1);
+  fill(*grid, ci.threadPool(), cmp_lst);
+  CompIFunction::num_rec(static_cast<unsigned int>(cmp_lst.size()));
+}
+
+
+std::int64_t CompEarthRot::grid_step() const
+{
+  return ExactTime::ns_from_minutes(dt_min);
+}
+
+
+void CompEarthRot::output_rate(double minutes)
+{
+  if (ExactTime::ns_from_minutes(minutes) <= 0) {
+    std::cerr << "\nEarthRot output rate must be positive\n";
+    throw std::invalid_argument("Invalid EarthRot output rate");
+  }
+  dt_min = minutes;
+}
+
+
+/*
+ * The full output axis is uniform, so it costs nothing to describe up
+ * front.  It is held by cmp_lst, otherwise empty while streaming, and
+ * shared with each chunk.
+ */
+std::size_t CompEarthRot::stream_begin(const CompISimulation& ci)
+{
+  ExactTime et_start {ci.startJD()};
+  std::int64_t dt_ns = ExactTime::ns_from_minutes(dt_min);
+  std::int64_t span_ns = ExactTime::ns_from_days(ci.simDays());
+  std::size_t npts = static_cast<std::size_t>(1 + span_ns/dt_ns);
+  auto axis = std::make_shared<CompTimeAxis>(et_start, dt_ns, npts);
+  CompIFunction::init_series(cmp_lst, axis, 1, 0, 0);
+  CompIFunction::num_rec(static_cast<unsigned int>(npts));
+  return npts;
+}
+
+
+void CompEarthRot::stream_chunk(const CompISimulation& ci,
+                                std::size_t first, std::size_t count,
+                                const std::vector<CompSeriesView>&,
+                                CompSeries& out) const
+{
+  const CompTimeAxis& axis = cmp_lst.axis();
+  if (first >= axis.size()) {
+    CompIFunction::init_series(out, cmp_lst.axis_ptr(), 1, axis.size(), 0);
+    return;
+  }
+  if (count > axis.size() - first) {
+    count = axis.size() - first;
+  }
+  CompIFunction::init_series(out, cmp_lst.axis_ptr(), 1, first, count);
+  std::shared_ptr<const CompTimeGrid> grid =
+                          ci.timeGrid(axis.exact(first), axis.step(), count);
+  fill(*grid, ci.threadPool(), out);
+}
+
+
+void CompEarthRot::fill(const CompTimeGrid& grid, ThreadPool* pool,
+                                                  CompSeries& cs) const
+{
+  std::size_t npts = cs.size();
+  auto fill_range = [&](std::size_t first, std::size_t count) {
+    std::size_t last = first + count;
+    for (std::size_t ii=first; ii<last; ++ii) {
+      cs.set(ii, gmst(grid, ii));
     }
-    cmp_lst.push_back(CompScalar(jd_now, sval));
-    jd_now += dt_days;
+  };
+
+    // Split into chunks large enough to amortize scheduling, but small
+    // enough that workers stay evenly loaded
+  if (pool != nullptr  &&  npts >= 2*MIN_CHUNK) {
+    std::size_t grain = npts/(4*pool->size()) + 1;
+    if (grain < MIN_CHUNK) {
+      grain = MIN_CHUNK;
+    }
+    pool->parallel_for(npts, grain, fill_range);
+  } else {
+    fill_range(0, npts);
   }
-  CompIFunction::num_rec(static_cast<unsigned int>(cmp_lst.size()));
 }
 
-void CompEarthRot::report(std::ostream& out) const
+
+double CompEarthRot::gmst(const CompTimeGrid& grid, std::size_t ndx) const
 {
-    // Set scale factor to zero - if not set below then something is broken
-  double ufactor {0.0};
-  std::string units {""};
-  if (CompIFunction::num_unit_types() == 1) {
-    units = CompIFunction::unit_labels(0);
-    ufactor = CompIFunction::unit_factors(0);
+  double sval {0.0};
+  switch (er_type) {
+      // For use with the IAU 1976 Precession and 1980 Nutation models
+    case EarthRotType::GMST1982:
+      sval = iauGmst82(grid.ut1_hi_val(ndx), grid.ut1_low_val(ndx));
+      break;
+      // For use with the IAU 2000+ Equinox based theories
+    case EarthRotType::GMST2000:
+      sval = iauGmst00(grid.ut1_hi_val(ndx), grid.ut1_low_val(ndx),
+                       grid.tt_hi_val(ndx),  grid.tt_low_val(ndx));
+      break;
   }
+  return sval;
+}
 
+std::string CompEarthRot::report_prefix() const
+{
     // Text representation of the type of earth rotation being computed.
   std::string type {""};
   switch (er_type) {
@@ -117,47 +196,5 @@ void CompEarthRot::report(std::ostream& out) const
       type = "GMST2000";
       break;
   }
-  int nval = static_cast<int>(cmp_lst.size());
-
-    // Send readable text to stream output
-  if (CompIFunction::report_stream()) {
-    for (int ii=0; ii<nval; ++ii) {
-      JulianDate jd = cmp_lst[ii].timeStamp();
-      char buf[128];
-      snprintf(buf, sizeof(buf),
-               "\n%s:  %1.13f %s at %s",
-                type.c_str(), ufactor*cmp_lst[ii].scalarValue(),
-                units.c_str(), jd.to_str().c_str());
-      out << buf;
-    }
-  }
-
-    // Output to comma separated value file?
-  if (CompIFunction::report_file()) {
-    std::string outfile_root = CompIFunction::label();
-    if (outfile_root.length() > 0) {
-      std::string csv_filename = outfile_root + ".csv";
-      std::ofstream csv_file;
-      csv_file.open (csv_filename);
-      if (csv_file.is_open()) {
-        csv_file.precision(10);
-        for (int ii=0; ii<nval; ++ii) {
-          JulianDate jd = cmp_lst[ii].timeStamp();
-          char buf[128];
-          snprintf(buf, sizeof(buf), "%1.13f,%1.13f", jd.mjd(),
-                                     ufactor*cmp_lst[ii].scalarValue());
-          csv_file << buf << '\n';
-        }
-      } else {
-        std::cerr << "\nCan't open output file " << csv_filename << '\n';
-      }
-      csv_file.close();
-    }
-  }
-}
-
-std::unique_ptr<CompIRecord> CompEarthRot::record(unsigned int ndx) const
-{
-  return std::unique_ptr<CompIRecord> (new CompScalar(cmp_lst[ndx].timeStamp(),
-                                                  cmp_lst[ndx].scalarValue()));
+  return type + ":  ";
 }
@@ -6,11 +6,35 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <cstddef>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
+#include <comp_irecord.h>
+#include <comp_scalar.h>
+#include <comp_series.h>
+#include <comp_label_registry.h>
+#include <comp_report_sink.h>
+#include <utl_io_stage.h>
 #include <comp_ifunction.h>
 
+std::string CompIFunction::type_name() const
+{
+  for (const auto& entry : function_table) {
+    if (entry.second == comp_type) {
+      return entry.first;
+    }
+  }
+  return "";
+}
+
+
 /*
  * Parses function label name and options.
  */
@@ -24,6 +48,7 @@ void CompIFunction::report_options(const std::string& rptstr)
   do_ostream = false;
   do_label = false;
   do_file = false;
+  do_binary = false;
     // "Token" to indicate the presence of label options
   static const std::string separator(":");
   std::size_t found = fnct_label.find(separator);
@@ -32,7 +57,7 @@ void CompIFunction::report_options(const std::string& rptstr)
     // by default.
   if (found != std::string::npos) {
       // Maximum allowable found not including ':'
-    static constexpr std::size_t max_pos = static_cast<std::size_t>(3);
+    static constexpr std::size_t max_pos = static_cast<std::size_t>(4);
     if (found > max_pos) {
       throw std::invalid_argument("Invalid number of report options");
     } else {
@@ -45,6 +70,10 @@ void CompIFunction::report_options(const std::string& rptstr)
           case 'f':
             do_file = true;
             break;
+          case 'B':                         // Binary file output
+          case 'b':
+            do_binary = true;
+            break;
           case 'L':                         // Label
           case 'l':
             do_label = true;
@@ -65,32 +94,20 @@ void CompIFunction::report_options(const std::string& rptstr)
 }
 
 
-std::array<int, 2> CompIFunction::find_comp_locs(
-                     const std::string& lbl1, const  std::string& lbl2,
-                     const std::vector<std::unique_ptr<CompIFunction>>& comps)
+bool CompIFunction::add_inputs(const std::vector<std::string>& lbls,
+                               const CompLabelRegistry& registry)
 {
-  std::array<int, 2> vals {{ -1, -1}};
-
-  bool found_first  {false};
-  bool found_second {false};
-  unsigned int nrpts = static_cast<unsigned int>(comps.size());
-    // Search through list of comp functions and locate index
-    // corresponding to function labels that are to be compared
-  for (unsigned int ii=0; ii<nrpts; ++ii) {
-    if (comps[ii]->report_label()) {
-      if (!found_first  &&  comps[ii]->label().compare(lbl1) == 0) {
-        found_first = true;
-        vals[0] = ii;
-      } else if (!found_second  &&  comps[ii]->label().compare(lbl2) == 0) {
-        found_second = true;
-        vals[1] = ii;
-      }
-      if (found_first  &&  found_second) {
-          break;
-      }
+  std::vector<int> locs(lbls.size());
+  for (std::size_t ii=0; ii<lbls.size(); ++ii) {
+    locs[ii] = registry.location(lbls[ii]);
+    if (locs[ii] == CompLabelRegistry::NOT_FOUND  ||
+        std::find(locs.begin(), locs.begin() + ii, locs[ii]) !=
+                                                  locs.begin() + ii) {
+      return false;
     }
   }
-  return vals;
+  input_locs.insert(input_locs.end(), locs.begin(), locs.end());
+  return true;
 }
 
 
@@ -101,3 +118,60 @@ void CompIFunction::add_unit_type(std::string lbl, double factor, int offset)
   ufactors.push_back(factor);
   ubands.push_back(offset);
 }
+
+
+std::unique_ptr<CompIRecord> CompIFunction::record(unsigned int ndx) const
+{
+  CompSeriesView cv = results();
+  if (ndx >= cv.size()) {
+    throw std::out_of_range("Function record not held");
+  }
+  return std::unique_ptr<CompIRecord> (new CompScalar(cv.time(ndx),
+                                                      cv.values()[ndx]));
+}
+
+
+/*
+ * The header is routed through the sink so it stays in order with record
+ * text written by a background stage.
+ */
+void CompIFunction::report(std::ostream& out, IoStage* io) const
+{
+  std::unique_ptr<CompReportSink> sink = report_begin(out, io);
+  sink->write(results());
+  sink->close();
+}
+
+
+std::unique_ptr<CompReportSink> CompIFunction::report_begin(
+                                                      std::ostream& out,
+                                                      IoStage* io) const
+{
+  std::ostringstream hdr;
+  report_header(hdr);
+  std::unique_ptr<CompReportSink> sink(new CompReportSink(*this, out, io));
+  sink->header(hdr.str());
+  return sink;
+}
+
+
+std::size_t CompIFunction::stream_begin(const CompISimulation&)
+{
+  throw std::logic_error("Function does not support chunked execution");
+}
+
+
+void CompIFunction::stream_chunk(const CompISimulation&, std::size_t,
+                                 std::size_t,
+                                 const std::vector<CompSeriesView>&,
+                                 CompSeries&) const
+{
+  throw std::logic_error("Function does not support chunked execution");
+}
+
+
+void CompIFunction::output_rate(double)
+{
+  std::cerr << "\n" << type_name() << " has no output rate\n";
+  throw std::invalid_argument("Function has no output rate");
+}
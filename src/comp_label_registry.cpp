@@ -0,0 +1,53 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <comp_label_registry.h>
+
+constexpr int CompLabelRegistry::NOT_FOUND;
+
+/*
+ * Index keys view the interned strings, which never move once added to
+ * the deque, so lookups by string_view need no temporary strings.
+ */
+CompLabelRegistry::Handle CompLabelRegistry::intern(std::string_view label)
+{
+  auto entry = index.find(label);
+  if (entry != index.end()) {
+    return entry->second;
+  }
+  Handle handle = names.size();
+  names.emplace_back(label);
+  locs.push_back(NOT_FOUND);
+  index.emplace(std::string_view(names.back()), handle);
+  return handle;
+}
+
+
+bool CompLabelRegistry::bind(std::string_view label, int loc)
+{
+  Handle handle = intern(label);
+  if (locs[handle] != NOT_FOUND) {
+    return false;
+  }
+  locs[handle] = loc;
+  return true;
+}
+
+
+int CompLabelRegistry::location(std::string_view label) const
+{
+  auto entry = index.find(label);
+  return (entry != index.end()) ? locs[entry->second] : NOT_FOUND;
+}
@@ -0,0 +1,172 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <comp_ifunction.h>
+#include <comp_series.h>
+#include <comp_binary_writer.h>
+#include <astro_exact_time.h>
+#include <utl_buffered_writer.h>
+#include <utl_greg_formatter.h>
+#include <utl_io_stage.h>
+#include <comp_report_sink.h>
+
+constexpr int CompReportSink::TEXT_PRECISION;
+
+CompReportSink::CompReportSink(const CompIFunction& fn, std::ostream& out,
+                                                       IoStage* io) :
+                               prefix{fn.report_prefix()},
+                               do_text{fn.report_stream()},
+                               text_out{&out},
+                               text_io{io},
+                               func{fn},
+                               do_bin{fn.report_binary()  &&
+                                      fn.label().length() > 0}
+{
+  if (do_text) {
+    text.reset(new BufferedWriter(out, io));
+  }
+
+  int nunits = fn.num_unit_types();
+  for (int ii=0; ii<nunits; ++ii) {
+    factors.push_back(fn.unit_factors(ii));
+    labels.push_back(fn.unit_labels(ii));
+  }
+
+  if (fn.report_file()  &&  fn.label().length() > 0) {
+    std::string csv_filename = fn.file_name() + ".csv";
+    csv.reset(new BufferedWriter(csv_filename, io));
+    if (!csv->is_open()) {
+      std::cerr << "\nCan't open output file " << csv_filename << '\n';
+      csv.reset();
+    }
+  }
+}
+
+
+void CompReportSink::header(const std::string& str)
+{
+  if (text != nullptr) {
+    text->write(str);
+  } else if (text_out != nullptr) {
+    BufferedWriter hdr(*text_out, text_io);
+    hdr.write(str);
+  }
+}
+
+
+void CompReportSink::write(const CompSeriesView& view)
+{
+  std::size_t nval = view.size();
+  if (nval == 0) {
+    return;
+  }
+
+  if (do_bin) {
+    if (bin == nullptr) {
+      std::string bin_filename = func.file_name() + ".bin";
+      if (func.binary_buffer() != nullptr) {
+        bin.reset(new CompBinaryWriter(func.binary_buffer(), func,
+                                       view.axis(), view.width(), view,
+                                       func.compression()));
+      } else {
+        bin.reset(new CompBinaryWriter(bin_filename, func, view.axis(),
+                                       view.width(), view,
+                                       func.compression()));
+      }
+      if (!bin->is_open()) {
+        std::cerr << "\nCan't open output file " << bin_filename << '\n';
+        do_bin = false;
+        bin.reset();
+      }
+    }
+    if (bin != nullptr) {
+      bin->write(view);
+    }
+  }
+  if (!do_text  &&  csv == nullptr) {
+    return;
+  }
+
+    // Bands beyond those with units are written unscaled
+  int width = view.width();
+  int nbands = view.num_bands();
+  cols.assign(width, nullptr);
+  scale.assign(width, 1.0);
+  for (int band=0; band<nbands; ++band) {
+    int offset = view.band_offset(band);
+    int ncomp = view.band_width(band);
+    for (int jj=offset; jj<offset+ncomp; ++jj) {
+      cols[jj] = view.values(jj);
+      if (band < static_cast<int>(factors.size())) {
+        scale[jj] = factors[band];
+      }
+    }
+  }
+
+  for (std::size_t ii=0; ii<nval; ++ii) {
+    ExactTime et = view.exact(ii);
+    if (do_text) {
+      text->put('\n');
+      text->write(prefix);
+      for (int band=0; band<nbands; ++band) {
+        if (band > 0) {
+          text->write(", ", 2);
+        }
+        int offset = view.band_offset(band);
+        int ncomp = view.band_width(band);
+        for (int jj=offset; jj<offset+ncomp; ++jj) {
+          if (jj > offset) {
+            text->put(' ');
+          }
+          text->write_fixed(scale[jj]*cols[jj][ii], TEXT_PRECISION);
+        }
+        if (band < static_cast<int>(labels.size())) {
+          text->put(' ');
+          text->write(labels[band]);
+        }
+      }
+      text->write(" at ", 4);
+      text->write(gfmt.format(et.mjd_day(), et.ns_of_day()),
+                  GregFormatter::LENGTH);
+    }
+    if (csv != nullptr) {
+      csv->write_shortest(et.mjd());
+      for (int jj=0; jj<width; ++jj) {
+        csv->put(',');
+        csv->write_shortest(scale[jj]*cols[jj][ii]);
+      }
+      csv->put('\n');
+    }
+  }
+}
+
+
+void CompReportSink::close()
+{
+  if (text != nullptr) {
+    text->flush();
+    text.reset();
+  }
+  text_out = nullptr;
+  if (csv != nullptr) {
+    csv->flush();
+    csv.reset();
+  }
+  if (bin != nullptr) {
+    bin->close();
+    bin.reset();
+  }
+  do_bin = false;
+}
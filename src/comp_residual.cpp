@@ -0,0 +1,187 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cmath>
+
+#include <comp_residual.h>
+
+#if defined(__GNUC__)  &&  (defined(__x86_64__)  ||  defined(__i386__))
+#define VMSAT_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+using AbsDiffFn = void (*)(const double*, const double*, double*,
+                           std::size_t);
+using NormDiffFn = void (*)(const double* const*, const double* const*,
+                            int, double*, std::size_t);
+
+/*
+ * Scalar versions - also used to finish the tail of vectorized loops.
+ * The squared sum is accumulated in component order to match the
+ * vectorized versions exactly.
+ */
+static void abs_diff_scalar(const double* a, const double* b,
+                            double* out, std::size_t n)
+{
+  for (std::size_t ii=0; ii<n; ++ii) {
+    out[ii] = std::fabs(a[ii] - b[ii]);
+  }
+}
+
+
+static void norm_diff_range(const double* const* a, const double* const* b,
+                            int ncomp, double* out,
+                            std::size_t first, std::size_t n)
+{
+  for (std::size_t ii=first; ii<n; ++ii) {
+    double d = a[0][ii] - b[0][ii];
+    double sum = d*d;
+    for (int jj=1; jj<ncomp; ++jj) {
+      d = a[jj][ii] - b[jj][ii];
+      sum = sum + d*d;
+    }
+    out[ii] = std::sqrt(sum);
+  }
+}
+
+
+static void norm_diff_scalar(const double* const* a, const double* const* b,
+                             int ncomp, double* out, std::size_t n)
+{
+  norm_diff_range(a, b, ncomp, out, 0, n);
+}
+
+
+#ifdef VMSAT_X86_DISPATCH
+
+__attribute__((target("sse2")))
+static void abs_diff_sse2(const double* a, const double* b,
+                          double* out, std::size_t n)
+{
+  const __m128d sign = _mm_set1_pd(-0.0);
+  std::size_t ii = 0;
+  for (; ii+2<=n; ii+=2) {
+    __m128d d = _mm_sub_pd(_mm_loadu_pd(a + ii), _mm_loadu_pd(b + ii));
+    _mm_storeu_pd(out + ii, _mm_andnot_pd(sign, d));
+  }
+  abs_diff_scalar(a + ii, b + ii, out + ii, n - ii);
+}
+
+
+__attribute__((target("sse2")))
+static void norm_diff_sse2(const double* const* a, const double* const* b,
+                           int ncomp, double* out, std::size_t n)
+{
+  std::size_t ii = 0;
+  for (; ii+2<=n; ii+=2) {
+    __m128d d = _mm_sub_pd(_mm_loadu_pd(a[0] + ii), _mm_loadu_pd(b[0] + ii));
+    __m128d sum = _mm_mul_pd(d, d);
+    for (int jj=1; jj<ncomp; ++jj) {
+      d = _mm_sub_pd(_mm_loadu_pd(a[jj] + ii), _mm_loadu_pd(b[jj] + ii));
+      sum = _mm_add_pd(sum, _mm_mul_pd(d, d));
+    }
+    _mm_storeu_pd(out + ii, _mm_sqrt_pd(sum));
+  }
+  norm_diff_range(a, b, ncomp, out, ii, n);
+}
+
+
+__attribute__((target("avx2")))
+static void abs_diff_avx2(const double* a, const double* b,
+                          double* out, std::size_t n)
+{
+  const __m256d sign = _mm256_set1_pd(-0.0);
+  std::size_t ii = 0;
+  for (; ii+4<=n; ii+=4) {
+    __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a + ii),
+                              _mm256_loadu_pd(b + ii));
+    _mm256_storeu_pd(out + ii, _mm256_andnot_pd(sign, d));
+  }
+  abs_diff_scalar(a + ii, b + ii, out + ii, n - ii);
+}
+
+
+__attribute__((target("avx2")))
+static void norm_diff_avx2(const double* const* a, const double* const* b,
+                           int ncomp, double* out, std::size_t n)
+{
+  std::size_t ii = 0;
+  for (; ii+4<=n; ii+=4) {
+    __m256d d = _mm256_sub_pd(_mm256_loadu_pd(a[0] + ii),
+                              _mm256_loadu_pd(b[0] + ii));
+    __m256d sum = _mm256_mul_pd(d, d);
+    for (int jj=1; jj<ncomp; ++jj) {
+      d = _mm256_sub_pd(_mm256_loadu_pd(a[jj] + ii),
+                        _mm256_loadu_pd(b[jj] + ii));
+      sum = _mm256_add_pd(sum, _mm256_mul_pd(d, d));
+    }
+    _mm256_storeu_pd(out + ii, _mm256_sqrt_pd(sum));
+  }
+  norm_diff_range(a, b, ncomp, out, ii, n);
+}
+
+#endif  // VMSAT_X86_DISPATCH
+
+
+/*
+ * Kernel selection, performed once on first use
+ */
+namespace {
+  struct Kernels {
+    AbsDiffFn abs_diff {abs_diff_scalar};
+    NormDiffFn norm_diff {norm_diff_scalar};
+    const char* isa {"scalar"};
+
+    Kernels()
+    {
+#ifdef VMSAT_X86_DISPATCH
+      __builtin_cpu_init();
+      if (__builtin_cpu_supports("avx2")) {
+        abs_diff = abs_diff_avx2;
+        norm_diff = norm_diff_avx2;
+        isa = "avx2";
+      } else if (__builtin_cpu_supports("sse2")) {
+        abs_diff = abs_diff_sse2;
+        norm_diff = norm_diff_sse2;
+        isa = "sse2";
+      }
+#endif
+    }
+  };
+
+  const Kernels& kernels()
+  {
+    static const Kernels selected;
+    return selected;
+  }
+}
+
+
+void CompResidual::abs_diff(const double* a, const double* b,
+                            double* out, std::size_t n)
+{
+  kernels().abs_diff(a, b, out, n);
+}
+
+
+void CompResidual::norm_diff(const double* const* a, const double* const* b,
+                             int ncomp, double* out, std::size_t n)
+{
+  if (ncomp == 1) {
+    kernels().abs_diff(a[0], b[0], out, n);
+  } else if (ncomp > 1) {
+    kernels().norm_diff(a, b, ncomp, out, n);
+  }
+}
+
+
+const char* CompResidual::isa()
+{
+  return kernels().isa;
+}
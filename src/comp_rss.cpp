@@ -6,11 +6,11 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <cstddef>
 #include <memory>
+#include <memory_resource>
 #include <iostream>
-#include <fstream>
 #include <stdexcept>
-#include <array>
 #include <vector>
 #include <string>
 
@@ -18,47 +18,52 @@
 #include <comp_ifunction.h>
 #include <comp_irecord.h>
 #include <comp_scalar.h>
+#include <comp_series.h>
+#include <comp_label_registry.h>
+#include <comp_time_axis.h>
+#include <comp_residual.h>
 #include <comp_rss.h>
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
 
 
 CompRSS::CompRSS(const std::vector<std::string>& funct_params,
-                 const std::vector<std::unique_ptr<CompIFunction>>& comps)
-                                                 : CompIFunction(CompType::RSS)
+                 const std::vector<std::unique_ptr<CompIFunction>>& comps,
+                 const CompLabelRegistry& registry,
+                 std::pmr::memory_resource* mr) :
+                                                 CompIFunction(CompType::RSS),
+                                                 cmp_lst{mr}
 {
   comps_ptr = &comps;
   unsigned int nparams = static_cast<unsigned int>(funct_params.size());
   if (nparams < 5  &&  nparams > 2) {
-    label1 = funct_params[1];
-    label2 = funct_params[2];
       // Locate functions by labels
-    std::array<int, 2> fndxs = CompIFunction::find_comp_locs(label1, label2,
-                                                                      comps);
-    if (fndxs[0] >= 0  &&  fndxs[1] >=0) {
-      found = true;
-      f1ndx = fndxs[0];
-      f2ndx = fndxs[1];
+    if (!CompIFunction::add_inputs({funct_params[1], funct_params[2]},
+                                   registry)) {
+      std::cerr << "\nRSS types not found or not distinct\n";
+      throw std::invalid_argument("Invalid RSS parameters");
     }
+    f1ndx = CompIFunction::inputs()[0];
+    f2ndx = CompIFunction::inputs()[1];
 
       // Initial check for compatibility - number of records needs to
       // still be checked during execution of this function since the
       // input functions probably haven't been populated yet.
-    if (!found) {
-      std::cerr << "\nRSS types not found\n";
-      throw std::invalid_argument("Invalid RSS parameters");
-    }
       // Set units if types match
     if (comps[f1ndx]->ftype() != comps[f2ndx]->ftype()) {
       std::cerr << "\nFunctions to RSS don't match\n";
       throw std::invalid_argument("Functions to RSS don't match");
     }
-    if (comps[f1ndx]->num_unit_types() == 1) {
-      CompIFunction::add_unit_type(comps[f1ndx]->unit_labels(0),
-                                  comps[f1ndx]->unit_factors(0),
-                                  comps[f1ndx]->unit_offsets(0));
+      // One RSS value per input unit type (band)
+    int nunits = comps[f1ndx]->num_unit_types();
+    if (nunits > 0  &&  nunits == comps[f2ndx]->num_unit_types()) {
+      for (int ii=0; ii<nunits; ++ii) {
+        CompIFunction::add_unit_type(comps[f1ndx]->unit_labels(ii),
+                                     comps[f1ndx]->unit_factors(ii), ii);
+      }
     } else {
-      std::cerr << "\nCan't RSS results with multiple types\n";
-      throw std::invalid_argument("Can't RSS results with multiple types");
+      std::cerr << "\nFunctions to RSS have different unit types\n";
+      throw std::invalid_argument("RSS unit types don't match");
     }
     if (nparams == 4) {
       try {
@@ -73,71 +78,127 @@ CompRSS::CompRSS(const std::vector<std::string>& funct_params,
   }
 }
 
-void CompRSS::execute(const CompISimulation& ci)
+void CompRSS::execute(const CompISimulation&)
 {
     // check compatibility (type, number, delta)
-  if (found  &&  (*comps_ptr)[f1ndx]->label().compare(label1) == 0  &&
-                 (*comps_ptr)[f2ndx]->label().compare(label2) == 0) {
-    unsigned int npts1 = (*comps_ptr)[f1ndx]->num_records();
-    unsigned int npts2 = (*comps_ptr)[f2ndx]->num_records();
-    if (npts1 == npts2) {
-      cmp_lst.reserve(npts1);
-      for (unsigned int ii=0; ii<npts1; ++ii) {
-        std::unique_ptr<CompIRecord> cr1 = (*comps_ptr)[f1ndx]->record(ii);
-        std::unique_ptr<CompIRecord> cr2 = (*comps_ptr)[f2ndx]->record(ii);
-        CompIRecord *cs1ptr = cr1.get();
-        CompIRecord *cs2ptr = cr2.get();
-        JulianDate jd1 = cs1ptr->timeStamp();
-        JulianDate jd2 = cs2ptr->timeStamp();
-        if (jd1 - jd2  !=  0.0) {
-          std::cerr << "\nJDs in RSS not equal";
-        }
-        double rss_val = cs1ptr->rss(cs2ptr);
-        cmp_lst.push_back(CompScalar(jd1, rss_val));
-      }
-    } else {
-      std::cerr << "\nRSS types don't match or have moved\n";
+  CompSeriesView cv1 = (*comps_ptr)[f1ndx]->results();
+  CompSeriesView cv2 = (*comps_ptr)[f2ndx]->results();
+  std::size_t npts = cv1.size();
+  if (compatible(cv1, cv2, npts, cv2.size())) {
+    if (!cv1.axis().same_times(cv2.axis())) {
+      std::cerr << "\nJDs in RSS not equal";
     }
+      // Results share the time axis of the first input
+    CompIFunction::init_series(cmp_lst, cv1.axis_ptr(), cv1.num_bands());
+    residual(cv1, cv2, cmp_lst);
+    CompIFunction::num_rec(static_cast<unsigned int>(cmp_lst.size()));
   } else {
-    std::cerr << "\nRSS not found or labels no longer match\n";
-  } 
+    std::cerr << "\nRSS types don't match\n";
+  }
 }
 
-void CompRSS::report(std::ostream& out) const
+
+std::size_t CompRSS::stream_begin(const CompISimulation&)
 {
-    // Set scale factor to zero - if not set below then something is broken
-  double ufactor {0.0};
-  std::string units {""};
-  if (CompIFunction::num_unit_types() == 1) {
-    units = CompIFunction::unit_labels(0);
-    ufactor = CompIFunction::unit_factors(0);
+  stream_ok = false;
+  CompSeriesView cv1 = (*comps_ptr)[f1ndx]->results();
+  CompSeriesView cv2 = (*comps_ptr)[f2ndx]->results();
+  std::size_t npts = (*comps_ptr)[f1ndx]->num_records();
+  if (compatible(cv1, cv2, npts, (*comps_ptr)[f2ndx]->num_records())) {
+    if (!cv1.axis().same_times(cv2.axis())) {
+      std::cerr << "\nJDs in RSS not equal";
+    }
+    CompIFunction::init_series(cmp_lst, cv1.axis_ptr(), cv1.num_bands(),
+                               0, 0);
+    CompIFunction::num_rec(static_cast<unsigned int>(npts));
+    stream_ok = true;
+    return npts;
   }
+  std::cerr << "\nRSS types don't match\n";
+  return 0;
+}
 
-  int nval = static_cast<int>(cmp_lst.size());
 
-    // Send readable text to stream output
-  out << "\nRSS " << (*comps_ptr)[f1ndx]->label() <<
-            " & " << (*comps_ptr)[f2ndx]->label();
-  out << "\nNumber of records compared:  " << nval;
-  if (CompIFunction::report_stream()) {
-    for (int ii=0; ii<nval; ++ii) {
-      JulianDate jd = cmp_lst[ii].timeStamp();
-      char buf[128];                          
-      snprintf(buf, sizeof(buf),
-               "\n %1.13f %s at %s", ufactor*cmp_lst[ii].scalarValue(),
-                                     units.c_str(), jd.to_str().c_str());
-      out << buf;
+/*
+ * The output chunk shares the time axis of the first input, set up by
+ * stream_begin().
+ */
+void CompRSS::stream_chunk(const CompISimulation&, std::size_t,
+                           std::size_t,
+                           const std::vector<CompSeriesView>& in,
+                           CompSeries& out) const
+{
+  if (!stream_ok) {
+    return;
+  }
+  const CompSeriesView& cv1 = in[0];
+  const CompSeriesView& cv2 = in[1];
+  if (cv1.first() != cv2.first()  ||  cv1.size() != cv2.size()) {
+    std::cerr << "\nRSS input chunks don't match\n";
+    throw std::logic_error("RSS input chunks don't match");
+  }
+  CompIFunction::init_series(out, cmp_lst.axis_ptr(), cv1.num_bands(),
+                             cv1.first(), cv1.size());
+  residual(cv1, cv2, out);
+}
+
+
+/*
+ * Residual kernels walk matching columns of the two inputs record by
+ * record, so the band layouts must agree column for column and the
+ * records must start at the same time.
+ */
+bool CompRSS::compatible(const CompSeriesView& cv1,
+                         const CompSeriesView& cv2,
+                         std::size_t n1, std::size_t n2) const
+{
+  if (n1 != n2  ||  cv1.width() != cv2.width()  ||
+                    cv1.num_bands() != cv2.num_bands()) {
+    return false;
+  }
+  for (int band=0; band<cv1.num_bands(); ++band) {
+    if (cv1.band_offset(band) != cv2.band_offset(band)  ||
+        cv1.band_width(band) != cv2.band_width(band)) {
+      return false;
     }
   }
+  if (n1 == 0) {
+    return true;
+  }
+  const CompTimeAxis& ax1 = cv1.axis();
+  const CompTimeAxis& ax2 = cv2.axis();
+  return cv1.first() < ax1.size()  &&  cv2.first() < ax2.size()  &&
+         ax1.exact(cv1.first()) == ax2.exact(cv2.first());
+}
+
 
-    // Output to comma separated value file?
-  if (CompIFunction::report_file()) {
-    ;
+/*
+ * Scalar bands reduce to an absolute difference and vector bands
+ * (position, velocity, ...) to the L2 norm of the residual
+ */
+void CompRSS::residual(const CompSeriesView& cv1, const CompSeriesView& cv2,
+                                                  CompSeries& cs) const
+{
+  int nbands = cv1.num_bands();
+  std::vector<const double*> a;
+  std::vector<const double*> b;
+  for (int band=0; band<nbands; ++band) {
+    int offset = cv1.band_offset(band);
+    int ncomp = cv1.band_width(band);
+    a.clear();
+    b.clear();
+    for (int jj=offset; jj<offset+ncomp; ++jj) {
+      a.push_back(cv1.values(jj));
+      b.push_back(cv2.values(jj));
+    }
+    CompResidual::norm_diff(a.data(), b.data(), ncomp,
+                            cs.column_data(band), cv1.size());
   }
 }
 
-std::unique_ptr<CompIRecord> CompRSS::record(unsigned int ndx) const
+void CompRSS::report_header(std::ostream& out) const
 {
-  return std::unique_ptr<CompIRecord> (new CompScalar(cmp_lst[ndx].timeStamp(),
-                                                  cmp_lst[ndx].scalarValue()));
+  out << "\nRSS " << (*comps_ptr)[f1ndx]->label() <<
+            " & " << (*comps_ptr)[f2ndx]->label();
+  out << "\nNumber of records compared:  " << num_records();
 }
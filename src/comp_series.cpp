@@ -0,0 +1,217 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <memory_resource>
+#include <stdexcept>
+#include <vector>
+
+#include <astro_julian_date.h>
+#include <astro_exact_time.h>
+#include <comp_time_axis.h>
+#include <utl_gorilla.h>
+#include <comp_series.h>
+
+void CompSeries::reset(const ExactTime& epoch, int width,
+                       const std::vector<int>& bands)
+{
+  set_layout(width, bands);
+  own_axis = std::make_shared<CompTimeAxis>(epoch);
+  taxis = own_axis;
+}
+
+
+void CompSeries::reset(const std::shared_ptr<const CompTimeAxis>& axis,
+                       int width, const std::vector<int>& bands)
+{
+  reset(axis, width, bands, 0, axis->size());
+}
+
+
+void CompSeries::reset(const std::shared_ptr<const CompTimeAxis>& axis,
+                       int width, const std::vector<int>& bands,
+                       std::size_t first, std::size_t count)
+{
+  set_layout(width, bands);
+  own_axis.reset();
+  taxis = axis;
+  window(first, count);
+}
+
+
+void CompSeries::window(std::size_t first, std::size_t count)
+{
+  if (own_axis != nullptr) {
+    throw std::logic_error("Can't window a CompSeries owning its time axis");
+  }
+  if (first + count > taxis->size()) {
+    throw std::out_of_range("CompSeries window extends past time axis");
+  }
+  std::vector<GorillaColumn>().swap(pcols);
+  npacked = 0;
+  packed = false;
+  base = first;
+  for (auto& col : vcols) {
+    col.assign(count, 0.0);
+  }
+}
+
+
+void CompSeries::set_layout(int width, const std::vector<int>& bands)
+{
+  if (width < 1  ||  bands.empty()  ||  bands.front() != 0  ||
+                                        bands.back() >= width) {
+    throw std::invalid_argument("Invalid CompSeries record layout");
+  }
+  vcols.assign(width, std::pmr::vector<double>(vcols.get_allocator()));
+  ubands.assign(bands.begin(), bands.end());
+  base = 0;
+  std::vector<GorillaColumn>().swap(pcols);
+  npacked = 0;
+  packed = false;
+}
+
+
+void CompSeries::clear()
+{
+  if (own_axis != nullptr) {
+    own_axis = std::make_shared<CompTimeAxis>(own_axis->epoch());
+    taxis = own_axis;
+  }
+  for (auto& col : vcols) {
+    std::pmr::vector<double>(col.get_allocator()).swap(col);
+  }
+  std::vector<GorillaColumn>().swap(pcols);
+  npacked = 0;
+  packed = false;
+}
+
+
+void CompSeries::reserve(std::size_t n)
+{
+  if (own_axis != nullptr) {
+    own_axis->reserve(n);
+  }
+  for (auto& col : vcols) {
+    col.reserve(n);
+  }
+}
+
+
+void CompSeries::push_back(const JulianDate& jd, double val)
+{
+  push_back(ExactTime(jd) - epoch(), &val);
+}
+
+
+void CompSeries::push_back(std::int64_t offset_ns, const double* vals)
+{
+  if (own_axis == nullptr) {
+    throw std::logic_error("Can't add records to a shared time axis");
+  }
+  if (packed) {
+    throw std::logic_error("Can't add records to a packed CompSeries");
+  }
+  own_axis->push_back(offset_ns);
+  int nc = width();
+  for (int ii=0; ii<nc; ++ii) {
+    vcols[ii].push_back(vals[ii]);
+  }
+}
+
+
+CompSeriesView CompSeries::view() const
+{
+  if (packed) {
+    throw std::logic_error("CompSeries must be unpacked before viewing");
+  }
+  return CompSeriesView(*this, 0, size());
+}
+
+
+void CompSeries::pack()
+{
+  if (packed) {
+    return;
+  }
+  npacked = size();
+  pcols.assign(vcols.size(), GorillaColumn());
+  for (std::size_t ii=0; ii<vcols.size(); ++ii) {
+    pcols[ii].append(vcols[ii].data(), vcols[ii].size());
+    std::pmr::vector<double>(vcols[ii].get_allocator()).swap(vcols[ii]);
+  }
+  packed = true;
+}
+
+
+void CompSeries::unpack()
+{
+  if (!packed) {
+    return;
+  }
+  for (std::size_t ii=0; ii<vcols.size(); ++ii) {
+    vcols[ii].resize(npacked);
+    pcols[ii].decode(0, npacked, vcols[ii].data());
+  }
+  std::vector<GorillaColumn>().swap(pcols);
+  npacked = 0;
+  packed = false;
+}
+
+
+std::size_t CompSeries::stored_bytes() const
+{
+  std::size_t nbytes {0};
+  if (packed) {
+    for (const auto& col : pcols) {
+      nbytes += col.bytes().size() +
+                col.block_offsets().size()*sizeof(std::uint64_t);
+    }
+  } else {
+    for (const auto& col : vcols) {
+      nbytes += col.size()*sizeof(double);
+    }
+  }
+  return nbytes;
+}
+
+
+void CompSeries::decode(std::size_t first, std::size_t n, int comp,
+                                                          double* out) const
+{
+  if (packed) {
+    pcols[comp].decode(first, n, out);
+  } else {
+    std::copy_n(vcols[comp].data() + first, n, out);
+  }
+}
+
+
+int CompSeries::band_width(int band) const
+{
+  int last = (band + 1 < num_bands()) ? ubands[band + 1] : width();
+  return last - ubands[band];
+}
+
+
+CompSeriesView CompSeriesView::chunk(std::size_t chunk,
+                                     std::size_t chunk_size) const
+{
+  std::size_t offset = chunk*chunk_size;
+  if (offset >= nrec) {
+    return CompSeriesView(*src, ndx0 + nrec, 0);
+  }
+  std::size_t count = nrec - offset;
+  if (count > chunk_size) {
+    count = chunk_size;
+  }
+  return CompSeriesView(*src, ndx0 + offset, count);
+}
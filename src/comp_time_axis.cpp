@@ -0,0 +1,71 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include <astro_exact_time.h>
+#include <comp_time_axis.h>
+
+constexpr std::size_t CompTimeAxis::NPOS;
+
+void CompTimeAxis::push_back(std::int64_t offset_ns)
+{
+  if (uniform) {
+    throw std::logic_error("Can't add times to a uniform time axis");
+  }
+  toff.push_back(offset_ns);
+}
+
+
+std::size_t CompTimeAxis::floor_index(const ExactTime& et) const
+{
+  std::size_t n = size();
+  std::int64_t off = et - et0;
+  if (n == 0  ||  off < offset(0)) {
+    return NPOS;
+  }
+
+  if (uniform) {
+    if (dt <= 0) {
+      return 0;
+    }
+    std::size_t ndx = static_cast<std::size_t>(off/dt);
+    return (ndx < n) ? ndx : n - 1;
+  }
+
+  auto itr = std::upper_bound(toff.begin(), toff.end(), off);
+  return static_cast<std::size_t>(itr - toff.begin()) - 1;
+}
+
+
+bool CompTimeAxis::same_times(const CompTimeAxis& axis) const
+{
+  if (this == &axis) {
+    return true;
+  }
+  std::size_t n = size();
+  if (n != axis.size()) {
+    return false;
+  }
+  if (n == 0) {
+    return true;
+  }
+  if (uniform  &&  axis.uniform) {
+    return et0 == axis.et0  &&  (n < 2  ||  dt == axis.dt);
+  }
+  std::int64_t shift = axis.et0 - et0;
+  for (std::size_t ii=0; ii<n; ++ii) {
+    if (offset(ii) != axis.offset(ii) + shift) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <astro_julian_date.h>
+#include <astro_exact_time.h>
+#include <astro_leap_sec.h>
+#include <astro_ut1mutc.h>
+#include <comp_time_axis.h>
+#include <utl_thread_pool.h>
+#include <comp_time_grid.h>
+
+constexpr double CompTimeGrid::TTMTAI;
+
+  // Minimum number of grid points per concurrently converted chunk
+constexpr static std::size_t MIN_CHUNK {4096};
+
+CompTimeGrid::CompTimeGrid(const ExactTime& start, std::int64_t step_ns,
+                           std::size_t count, const LeapSec& leap_sec,
+                           const UT1mUTC& ut1mutc, ThreadPool* pool,
+                           std::pmr::memory_resource* mr) :
+              taxis{std::allocate_shared<CompTimeAxis>(
+                      std::pmr::polymorphic_allocator<CompTimeAxis>(mr),
+                      start, step_ns, count)},
+              segs{mr}, ut1_low(count, mr)
+{
+  auto spans = leap_sec.segments(start, step_ns, count);
+  segs.assign(spans.begin(), spans.end());
+
+    // UT1 - UTC lookups start from the previous interval
+  auto fill = [&](std::size_t first, std::size_t n) {
+    std::size_t ut1_cursor {0};
+    std::size_t last = first + n;
+    for (std::size_t ii=first; ii<last; ++ii) {
+      ExactTime et = taxis->exact(ii);
+      ut1_low[ii] = et.jd_low() +
+                    ut1mutc.ut1Mutc(et, ut1_cursor)*JulianDate::DAY_PER_SEC;
+    }
+  };
+
+  if (pool != nullptr  &&  count >= 2*MIN_CHUNK) {
+    std::size_t grain = count/(4*pool->size()) + 1;
+    if (grain < MIN_CHUNK) {
+      grain = MIN_CHUNK;
+    }
+    pool->parallel_for(count, grain, fill);
+  } else {
+    fill(0, count);
+  }
+}
+
+
+/*
+ * A grid rarely spans a leap second, so the single segment case skips
+ * the search.
+ */
+double CompTimeGrid::tai_utc(std::size_t ndx) const
+{
+  if (segs.size() == 1) {
+    return segs.front().taimutc;
+  }
+  auto seg = std::upper_bound(segs.begin(), segs.end(), ndx,
+                              [](std::size_t n, const LeapSec::Segment& sg) {
+                                return n < sg.first;
+                              });
+  return (seg - 1)->taimutc;
+}
+
+
+/*
+ * The map lock is held only long enough to find or insert the slot.  The
+ * grid itself is computed under the slot's once_flag, so requests for
+ * other grids are not blocked while a large grid is being built.
+ */
+std::shared_ptr<const CompTimeGrid>
+CompTimeGridCache::get(const ExactTime& start, std::int64_t step_ns,
+                       std::size_t count, const LeapSec& leap_sec,
+                       const UT1mUTC& ut1mutc, ThreadPool* pool)
+{
+  Key key {start.mjd_day(), start.ns_of_day(), step_ns, count};
+  std::shared_ptr<Slot> slot;
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::shared_ptr<Slot>& entry = grids[key];
+    if (entry == nullptr) {
+      entry = std::allocate_shared<Slot>(
+                std::pmr::polymorphic_allocator<Slot>(arena));
+      if (max_size > 0) {
+        created.push_back(key);
+      }
+    }
+    slot = entry;
+    while (max_size > 0  &&  created.size() > max_size) {
+      grids.erase(created.front());
+      created.pop_front();
+    }
+  }
+  std::call_once(slot->once, [&] {
+    slot->grid = std::allocate_shared<CompTimeGrid>(
+                   std::pmr::polymorphic_allocator<CompTimeGrid>(arena),
+                   start, step_ns, count, leap_sec, ut1mutc, pool, arena);
+  });
+  return slot->grid;
+}
+
+
+void CompTimeGridCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  grids.clear();
+  created.clear();
+}
+
+
+void CompTimeGridCache::release(std::int64_t step_ns)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  for (auto entry = grids.begin(); entry != grids.end(); ) {
+    if (std::get<2>(entry->first) == step_ns) {
+      entry = grids.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
+  created.erase(std::remove_if(created.begin(), created.end(),
+                               [step_ns](const Key& key) {
+                                 return std::get<2>(key) == step_ns;
+                               }),
+                created.end());
+}
+
+
+void CompTimeGridCache::limit(std::size_t max_grids)
+{
+  std::lock_guard<std::mutex> lock(mtx);
+  max_size = max_grids;
+  created.clear();
+  if (max_size > 0) {
+    for (const auto& entry : grids) {
+      created.push_back(entry.first);
+    }
+  }
+}
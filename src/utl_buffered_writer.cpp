@@ -0,0 +1,127 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <utl_io_stage.h>
+#include <utl_buffered_writer.h>
+
+constexpr std::size_t BufferedWriter::DEFAULT_SIZE;
+
+  // Room for any double, fixed notation included (DBL_MAX has 309 digits)
+constexpr static std::size_t MAX_NUMBER {352};
+
+BufferedWriter::BufferedWriter(std::ostream& out, IoStage* io) :
+                                                     os{&out}, stage{io}
+{
+  buf = (stage != nullptr) ? stage->acquire() :
+                             std::vector<char>(DEFAULT_SIZE);
+}
+
+
+BufferedWriter::BufferedWriter(const std::string& filename, IoStage* io) :
+                   own_file{new std::ofstream(filename, std::ios::binary)},
+                   stage{io}
+{
+  if (own_file->is_open()) {
+    os = own_file.get();
+  }
+  buf = (stage != nullptr) ? stage->acquire() :
+                             std::vector<char>(DEFAULT_SIZE);
+}
+
+
+BufferedWriter::~BufferedWriter()
+{
+  flush();
+}
+
+
+void BufferedWriter::write(const char* str, std::size_t n)
+{
+  while (n > 0) {
+    if (len == buf.size()) {
+      drain();
+    }
+    std::size_t nput = std::min(n, buf.size() - len);
+    std::memcpy(buf.data() + len, str, nput);
+    len += nput;
+    str += nput;
+    n -= nput;
+  }
+}
+
+
+void BufferedWriter::write_shortest(double val)
+{
+  char* first = reserve(MAX_NUMBER);
+  std::to_chars_result res = std::to_chars(first, first + MAX_NUMBER, val);
+  len += static_cast<std::size_t>(res.ptr - first);
+}
+
+
+void BufferedWriter::write_fixed(double val, int precision)
+{
+  char* first = reserve(MAX_NUMBER + static_cast<std::size_t>(precision));
+  std::to_chars_result res = std::to_chars(first, buf.data() + buf.size(),
+                                           val, std::chars_format::fixed,
+                                           precision);
+  len += static_cast<std::size_t>(res.ptr - first);
+}
+
+
+void BufferedWriter::flush()
+{
+  drain();
+  if (os != nullptr) {
+    if (stage != nullptr) {
+      stage->sync(os);
+    } else {
+      os->flush();
+    }
+  }
+}
+
+
+/*
+ * @return   Location at which at least n characters may be written,
+ *           growing the buffer if n exceeds its size
+ */
+char* BufferedWriter::reserve(std::size_t n)
+{
+  if (n > buf.size() - len) {
+    drain();
+    if (n > buf.size()) {
+      buf.resize(n);
+    }
+  }
+  return buf.data() + len;
+}
+
+
+void BufferedWriter::drain()
+{
+  if (len > 0  &&  os != nullptr) {
+    if (stage != nullptr) {
+      stage->submit(os, std::move(buf), len);
+      buf = stage->acquire();
+    } else {
+      os->write(buf.data(), static_cast<std::streamsize>(len));
+    }
+  }
+  len = 0;
+}
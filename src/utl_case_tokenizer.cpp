@@ -0,0 +1,55 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <string_view>
+
+#include <utl_case_tokenizer.h>
+
+/*
+ * Same separators as formatted stream input in the "C" locale
+ */
+static bool is_space(char ch)
+{
+  return ch == ' '  ||  ch == '\n'  ||  ch == '\t'  ||
+         ch == '\r'  ||  ch == '\v'  ||  ch == '\f';
+}
+
+
+bool CaseTokenizer::next(std::string_view& token)
+{
+  std::size_t len = src.size();
+  for (;;) {
+    while (pos < len  &&  is_space(src[pos])) {
+      if (src[pos] == '\n') {
+        ++cur_line;
+        line_start = pos + 1;
+      }
+      ++pos;
+    }
+    if (pos == len) {
+      return false;
+    }
+    if (src[pos] != '#') {
+      break;
+    }
+    while (pos < len  &&  src[pos] != '\n'  &&  src[pos] != '\r') {
+      ++pos;
+    }
+  }
+
+  tok_start = pos;
+  tok_line = cur_line;
+  tok_col = static_cast<int>(pos - line_start) + 1;
+  while (pos < len  &&  !is_space(src[pos])) {
+    ++pos;
+  }
+  tok_end = pos;
+  token = src.substr(tok_start, pos - tok_start);
+  return true;
+}
@@ -0,0 +1,301 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <utl_gorilla.h>
+
+constexpr std::size_t GorillaColumn::BLOCK;
+constexpr std::size_t DodColumn::BLOCK;
+
+  // Largest leading zero count that fits the 5 bit field
+constexpr static int MAX_LEAD {31};
+
+/*
+ * Reads bits, most significant first, in the order written by BitStream.
+ */
+class BitReader {
+  public:
+    BitReader(const std::uint8_t* data, std::size_t byte_pos) :
+                                         ptr{data}, pos{8*byte_pos} {}
+
+    std::uint64_t get(int nbits)
+    {
+      std::uint64_t val {0};
+      while (nbits > 0) {
+        int avail = 8 - static_cast<int>(pos & 7);
+        int take = std::min(avail, nbits);
+        unsigned int bits = ptr[pos >> 3] >> (avail - take);
+        val = (val << take) | (bits & ((1u << take) - 1u));
+        pos += static_cast<std::size_t>(take);
+        nbits -= take;
+      }
+      return val;
+    }
+
+    bool bit()
+    {
+      bool set = ((ptr[pos >> 3] >> (7 - (pos & 7))) & 1u) != 0;
+      ++pos;
+      return set;
+    }
+
+  private:
+    const std::uint8_t* ptr;
+    std::size_t pos;
+};
+
+
+static std::uint64_t to_bits(double val)
+{
+  std::uint64_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+  return bits;
+}
+
+
+static double from_bits(std::uint64_t bits)
+{
+  double val;
+  std::memcpy(&val, &bits, sizeof(val));
+  return val;
+}
+
+
+static int leading_zeros(std::uint64_t val)
+{
+#if defined(__GNUC__)
+  return __builtin_clzll(val);
+#else
+  int nz {0};
+  for (std::uint64_t mask = 1ULL << 63; (val & mask) == 0; mask >>= 1) {
+    ++nz;
+  }
+  return nz;
+#endif
+}
+
+
+static int trailing_zeros(std::uint64_t val)
+{
+#if defined(__GNUC__)
+  return __builtin_ctzll(val);
+#else
+  int nz {0};
+  for (; (val & 1u) == 0; val >>= 1) {
+    ++nz;
+  }
+  return nz;
+#endif
+}
+
+
+void BitStream::put(std::uint64_t val, int nbits)
+{
+  while (nbits > 0) {
+    std::size_t byte = nbit >> 3;
+    if (byte == data.size()) {
+      data.push_back(0);
+    }
+    int avail = 8 - static_cast<int>(nbit & 7);
+    int take = std::min(avail, nbits);
+    unsigned int bits = static_cast<unsigned int>(val >> (nbits - take)) &
+                        ((1u << take) - 1u);
+    data[byte] |= static_cast<std::uint8_t>(bits << (avail - take));
+    nbit += static_cast<std::size_t>(take);
+    nbits -= take;
+  }
+}
+
+
+/*
+ * Control bits following the first value of each block:
+ *   '0'   Same as the previous value
+ *   '10'  XOR fits the previous leading/trailing zero window - only the
+ *         window bits follow
+ *   '11'  5 bits of leading zeros, 6 bits of (length - 1), then the
+ *         length meaningful bits of the XOR
+ */
+void GorillaColumn::append(const double* vals, std::size_t n)
+{
+  for (std::size_t ii=0; ii<n; ++ii) {
+    std::uint64_t cur = to_bits(vals[ii]);
+    if (count%BLOCK == 0) {
+      bs.align();
+      blocks.push_back(bs.bits()/8);
+      bs.put(cur, 64);
+      lead = -1;
+    } else {
+      std::uint64_t xval = cur ^ prev;
+      if (xval == 0) {
+        bs.put(0, 1);
+      } else {
+        int lz = std::min(leading_zeros(xval), MAX_LEAD);
+        int tz = trailing_zeros(xval);
+        if (lead >= 0  &&  lz >= lead  &&  tz >= trail) {
+          bs.put(2, 2);
+          bs.put(xval >> trail, 64 - lead - trail);
+        } else {
+          int len = 64 - lz - tz;
+          bs.put(3, 2);
+          bs.put(static_cast<std::uint64_t>(lz), 5);
+          bs.put(static_cast<std::uint64_t>(len - 1), 6);
+          bs.put(xval >> tz, len);
+          lead = lz;
+          trail = tz;
+        }
+      }
+    }
+    prev = cur;
+    ++count;
+  }
+}
+
+
+void GorillaColumn::decode(std::size_t first, std::size_t n,
+                                              double* out) const
+{
+  if (first + n > count) {
+    throw std::out_of_range("GorillaColumn decode beyond stored values");
+  }
+  const std::uint8_t* data = bs.bytes().data();
+  std::size_t ndx = first - first%BLOCK;
+  std::size_t last = first + n;
+  while (ndx < last) {
+    BitReader br(data, static_cast<std::size_t>(blocks[ndx/BLOCK]));
+    std::size_t blk_end = std::min(ndx + BLOCK, last);
+    std::uint64_t val = br.get(64);
+    int blead {0};
+    int btrail {0};
+    for (;;) {
+      if (ndx >= first) {
+        *out++ = from_bits(val);
+      }
+      if (++ndx == blk_end) {
+        break;
+      }
+      if (br.bit()) {
+        if (br.bit()) {
+          blead = static_cast<int>(br.get(5));
+          int len = static_cast<int>(br.get(6)) + 1;
+          btrail = 64 - blead - len;
+        }
+        val ^= br.get(64 - blead - btrail) << btrail;
+      }
+    }
+  }
+}
+
+
+void GorillaColumn::clear()
+{
+  bs.clear();
+  std::vector<std::uint64_t>().swap(blocks);
+  count = 0;
+}
+
+
+/*
+ * Each block starts with the full first value.  Following values are
+ * coded by the zigzag encoded change in the difference between values:
+ *   '0'               No change
+ *   '10'    7 bits
+ *   '110'   9 bits
+ *   '1110'  12 bits
+ *   '1111'  64 bits
+ */
+void DodColumn::append(const std::int64_t* vals, std::size_t n)
+{
+  for (std::size_t ii=0; ii<n; ++ii) {
+    std::int64_t cur = vals[ii];
+    if (count%BLOCK == 0) {
+      bs.align();
+      blocks.push_back(bs.bits()/8);
+      bs.put(static_cast<std::uint64_t>(cur), 64);
+      prev_delta = 0;
+    } else {
+        // Unsigned arithmetic so extreme differences wrap rather than
+        // overflow - decoding wraps back
+      std::uint64_t delta = static_cast<std::uint64_t>(cur) -
+                            static_cast<std::uint64_t>(prev);
+      std::uint64_t dod = delta - static_cast<std::uint64_t>(prev_delta);
+      std::uint64_t zz = (dod << 1) ^ (0 - (dod >> 63));
+      if (zz == 0) {
+        bs.put(0, 1);
+      } else if (zz < (1u << 7)) {
+        bs.put(2, 2);
+        bs.put(zz, 7);
+      } else if (zz < (1u << 9)) {
+        bs.put(6, 3);
+        bs.put(zz, 9);
+      } else if (zz < (1u << 12)) {
+        bs.put(14, 4);
+        bs.put(zz, 12);
+      } else {
+        bs.put(15, 4);
+        bs.put(zz, 64);
+      }
+      prev_delta = static_cast<std::int64_t>(delta);
+    }
+    prev = cur;
+    ++count;
+  }
+}
+
+
+void DodColumn::decode(std::size_t first, std::size_t n,
+                                          std::int64_t* out) const
+{
+  if (first + n > count) {
+    throw std::out_of_range("DodColumn decode beyond stored values");
+  }
+  const std::uint8_t* data = bs.bytes().data();
+  std::size_t ndx = first - first%BLOCK;
+  std::size_t last = first + n;
+  while (ndx < last) {
+    BitReader br(data, static_cast<std::size_t>(blocks[ndx/BLOCK]));
+    std::size_t blk_end = std::min(ndx + BLOCK, last);
+    std::uint64_t val = br.get(64);
+    std::uint64_t delta {0};
+    for (;;) {
+      if (ndx >= first) {
+        *out++ = static_cast<std::int64_t>(val);
+      }
+      if (++ndx == blk_end) {
+        break;
+      }
+      std::uint64_t zz {0};
+      if (br.bit()) {
+        if (!br.bit()) {
+          zz = br.get(7);
+        } else if (!br.bit()) {
+          zz = br.get(9);
+        } else if (!br.bit()) {
+          zz = br.get(12);
+        } else {
+          zz = br.get(64);
+        }
+      }
+      delta += (zz >> 1) ^ (0 - (zz & 1u));
+      val += delta;
+    }
+  }
+}
+
+
+void DodColumn::clear()
+{
+  bs.clear();
+  std::vector<std::uint64_t>().swap(blocks);
+  count = 0;
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <utl_greg_formatter.h>
+
+constexpr std::size_t GregFormatter::LENGTH;
+
+  // Julian Day Number at noon of MJD 0
+constexpr static std::int64_t MJD_JDN {2400001};
+constexpr static std::int64_t NS_PER_CS {10000000};   // Per centisecond
+constexpr static std::int64_t CS_PER_MIN {6000};
+constexpr static std::int64_t CS_PER_HR {360000};
+
+constexpr static int days_in_month[12] =
+  {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+/*
+ * Writes n digits of val, right to left, ending just before dst + n
+ */
+static void put_digits(char* dst, int n, int val)
+{
+  for (int ii=n-1; ii>=0; --ii) {
+    dst[ii] = static_cast<char>('0' + val%10);
+    val /= 10;
+  }
+}
+
+
+/*
+ * The day starts out invalid so the first call computes the date
+ */
+GregFormatter::GregFormatter() : day{INT64_MIN}
+{
+  std::memcpy(buf, "0000/00/00 00:00:00.00", LENGTH + 1);
+}
+
+
+const char* GregFormatter::format(std::int64_t mjd_day,
+                                  std::int64_t ns_of_day)
+{
+  if (mjd_day != day) {
+    if (day != INT64_MIN  &&  mjd_day == day + 1) {
+      next_day();
+    } else {
+      set_date(mjd_day);
+    }
+    day = mjd_day;
+    write_date();
+  }
+
+  std::int64_t cs = ns_of_day/NS_PER_CS;
+  int hour = static_cast<int>(cs/CS_PER_HR);
+  cs -= hour*CS_PER_HR;
+  int minutes = static_cast<int>(cs/CS_PER_MIN);
+  cs -= minutes*CS_PER_MIN;
+  put_digits(buf + 11, 2, hour);
+  put_digits(buf + 14, 2, minutes);
+  put_digits(buf + 17, 2, static_cast<int>(cs/100));
+  put_digits(buf + 20, 2, static_cast<int>(cs%100));
+
+  return buf;
+}
+
+
+/*
+ * Same integer algorithm used by JulianDate::jd2gd
+ */
+void GregFormatter::set_date(std::int64_t mjd_day)
+{
+  std::int64_t jd = mjd_day + MJD_JDN;
+  std::int64_t i, j, k, m, n;
+
+  m = jd+68569;
+  n = 4*m/146097;
+  m = m-(146097*n+3)/4;
+  i = 4000*(m+1)/1461001;
+  m = m-1461*i/4+31;
+  j = 80*m/2447;
+  k = m-2447*j/80;             // day
+  m = j/11;
+  j = j+2-12*m;                // month
+  i = 100*(n-49)+i+m;          // year
+
+  yr = static_cast<int>(i);
+  mnth = static_cast<int>(j);
+  dy = static_cast<int>(k);
+}
+
+
+void GregFormatter::next_day()
+{
+  int ndays = days_in_month[mnth - 1];
+  if (mnth == 2  &&  (yr%4 == 0  &&  (yr%100 != 0  ||  yr%400 == 0))) {
+    ndays++;
+  }
+  if (++dy > ndays) {
+    dy = 1;
+    if (++mnth > 12) {
+      mnth = 1;
+      yr++;
+    }
+  }
+}
+
+
+void GregFormatter::write_date()
+{
+  put_digits(buf, 4, yr);
+  put_digits(buf + 5, 2, mnth);
+  put_digits(buf + 8, 2, dy);
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <future>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <utl_bounded_queue.h>
+#include <utl_io_stage.h>
+
+constexpr std::size_t IoStage::DEFAULT_DEPTH;
+constexpr std::size_t IoStage::DEFAULT_BUFSIZE;
+
+IoStage::IoStage(std::size_t depth, std::size_t bufsize) :
+                            bsz{(bufsize > 0) ? bufsize : DEFAULT_BUFSIZE},
+                            items{depth}
+{
+  writer = std::thread(&IoStage::run, this);
+}
+
+
+IoStage::~IoStage()
+{
+  items.close();
+  writer.join();
+}
+
+
+std::vector<char> IoStage::acquire()
+{
+  std::vector<char> buf;
+  {
+    std::lock_guard<std::mutex> lock(free_mtx);
+    if (!free_bufs.empty()) {
+      buf = std::move(free_bufs.back());
+      free_bufs.pop_back();
+    }
+  }
+  buf.resize(bsz);
+  return buf;
+}
+
+
+void IoStage::submit(std::ostream* os, std::vector<char>&& buf,
+                                       std::size_t len)
+{
+  Item item;
+  item.os = os;
+  item.buf = std::move(buf);
+  item.len = len;
+  items.push(std::move(item));
+}
+
+
+void IoStage::sync(std::ostream* os)
+{
+  std::promise<void> done;
+  std::future<void> flushed = done.get_future();
+  Item item;
+  item.os = os;
+  item.done = &done;
+  if (items.push(std::move(item))) {
+    flushed.wait();
+  }
+}
+
+
+/*
+ * Only buffers the stage could hand out again are kept for reuse, so the
+ * free list never holds more than a queue's worth of memory.
+ */
+void IoStage::run()
+{
+  Item item;
+  while (items.pop(item)) {
+    if (item.os != nullptr  &&  item.len > 0) {
+      item.os->write(item.buf.data(),
+                     static_cast<std::streamsize>(item.len));
+    }
+    if (item.done != nullptr) {
+      if (item.os != nullptr) {
+        item.os->flush();
+      }
+      item.done->set_value();
+    }
+    if (item.buf.capacity() > 0) {
+      std::lock_guard<std::mutex> lock(free_mtx);
+      if (free_bufs.size() < items.capacity()) {
+        free_bufs.push_back(std::move(item.buf));
+      }
+    }
+    item = Item();
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <utl_mapped_file.h>
+
+/*
+ * Empty regular files have nothing to map and are simply open with no
+ * text.  Everything that isn't a nonempty regular file, or fails to map,
+ * is read through the descriptor.
+ */
+MappedFile::MappedFile(const std::string& file_name)
+{
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;
+  }
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0  &&  S_ISREG(file_stat.st_mode)  &&
+                                      file_stat.st_size > 0) {
+    std::size_t size = static_cast<std::size_t>(file_stat.st_size);
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) {
+      addr = static_cast<const char*>(map);
+      len = size;
+      mapped = true;
+      opened = true;
+      close(fd);
+      return;
+    }
+  }
+
+  char buf[1 << 16];
+  ssize_t nread;
+  while ((nread = read(fd, buf, sizeof(buf))) > 0) {
+    copy.append(buf, static_cast<std::size_t>(nread));
+  }
+  close(fd);
+  if (nread == 0) {
+    addr = copy.data();
+    len = copy.size();
+    opened = true;
+  }
+}
+
+
+MappedFile::~MappedFile()
+{
+  if (mapped) {
+    munmap(const_cast<char*>(addr), len);
+  }
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <utl_thread_pool.h>
+
+  // Pool and queue of the worker running on this thread, if any
+static thread_local const ThreadPool* this_pool {nullptr};
+static thread_local std::size_t this_queue {0};
+
+ThreadPool::ThreadPool(unsigned int nthreads)
+{
+  if (nthreads == 0) {
+    nthreads = std::thread::hardware_concurrency();
+  }
+  if (nthreads == 0) {
+    nthreads = 1;
+  }
+  queues.reserve(nthreads);
+  for (unsigned int ii=0; ii<nthreads; ++ii) {
+    queues.emplace_back(new TaskQueue());
+  }
+  workers.reserve(nthreads);
+  for (unsigned int ii=0; ii<nthreads; ++ii) {
+    workers.emplace_back(&ThreadPool::run, this, ii);
+  }
+}
+
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mtx);
+    stopping = true;
+  }
+  cv.notify_all();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+
+/*
+ * A sleeping worker registers in nsleeping before its final check of
+ * pending, and the submitter counts the task in pending before checking
+ * nsleeping, so either the worker sees the task or the submitter sees the
+ * sleeper.  The lock is only taken when there is someone to wake.
+ */
+void ThreadPool::submit(std::function<void()> task)
+{
+  std::size_t ndx = (this_pool == this) ? this_queue :
+                                          next_queue++ % queues.size();
+  {
+    std::lock_guard<std::mutex> lock(queues[ndx]->mtx);
+    queues[ndx]->tasks.push_back(std::move(task));
+  }
+  ++pending;
+  if (nsleeping > 0) {
+    std::lock_guard<std::mutex> lock(mtx);
+    cv.notify_one();
+  }
+}
+
+
+/*
+ * Chunk bookkeeping shared between the caller and helper tasks.  Helper
+ * tasks may start after all chunks have been claimed (and the caller has
+ * returned), so the state is reference counted and fn is only touched
+ * when a chunk is successfully claimed.
+ */
+namespace {
+  struct ForState {
+    std::atomic<std::size_t> next {0};
+    std::size_t nchunks {0};
+    std::size_t ndone {0};
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::exception_ptr error;
+  };
+}
+
+
+void ThreadPool::parallel_for(std::size_t n, std::size_t grain,
+                     const std::function<void(std::size_t, std::size_t)>& fn)
+{
+  if (grain == 0) {
+    grain = 1;
+  }
+  std::size_t nchunks = (n + grain - 1)/grain;
+  if (nchunks < 2  ||  size() < 2) {
+    if (n > 0) {
+      fn(0, n);
+    }
+    return;
+  }
+
+  std::shared_ptr<ForState> state = std::make_shared<ForState>();
+  state->nchunks = nchunks;
+  const std::function<void(std::size_t, std::size_t)>* fptr = &fn;
+  auto work = [state, fptr, n, grain]() {
+    for (;;) {
+      std::size_t chunk = state->next++;
+      if (chunk >= state->nchunks) {
+        break;
+      }
+      std::size_t first = chunk*grain;
+      std::size_t count = std::min(grain, n - first);
+      try {
+        (*fptr)(first, count);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(state->mtx);
+        if (!state->error) {
+          state->error = std::current_exception();
+        }
+      }
+      std::lock_guard<std::mutex> lock(state->mtx);
+      if (++state->ndone == state->nchunks) {
+        state->cv.notify_all();
+      }
+    }
+  };
+
+  std::size_t nhelpers = std::min(static_cast<std::size_t>(size()),
+                                  nchunks - 1);
+  for (std::size_t ii=0; ii<nhelpers; ++ii) {
+    submit(work);
+  }
+  work();
+
+  std::unique_lock<std::mutex> lock(state->mtx);
+  state->cv.wait(lock, [&state] { return state->ndone == state->nchunks; });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+}
+
+
+/*
+ * Newest from the worker's own queue, otherwise oldest from the next
+ * nonempty queue
+ */
+bool ThreadPool::take(std::size_t ndx, std::function<void()>& task)
+{
+  {
+    TaskQueue& own = *queues[ndx];
+    std::lock_guard<std::mutex> lock(own.mtx);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      --pending;
+      return true;
+    }
+  }
+  std::size_t nqueues = queues.size();
+  for (std::size_t ii=1; ii<nqueues; ++ii) {
+    TaskQueue& victim = *queues[(ndx + ii)%nqueues];
+    std::lock_guard<std::mutex> lock(victim.mtx);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      --pending;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+/*
+ * Worker loop - take tasks until the pool is stopping and all queues
+ * have been drained.
+ */
+void ThreadPool::run(std::size_t ndx)
+{
+  this_pool = this;
+  this_queue = ndx;
+  for (;;) {
+    std::function<void()> task;
+    if (take(ndx, task)) {
+      try {
+        task();
+      } catch (...) {
+        ;  // Tasks are responsible for their own error handling
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    ++nsleeping;
+    cv.wait(lock, [this] { return stopping  ||  pending > 0; });
+    --nsleeping;
+    if (stopping  &&  pending == 0) {
+      return;
+    }
+  }
+}
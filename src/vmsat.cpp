@@ -6,10 +6,16 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <exception>
 #include <iostream>
-#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 #include <vmsat_case.h>
+#include <vmsat_batch.h>
+#include <vmsat_server.h>
+#include <utl_mapped_file.h>
 
 /**
  * This is the main function to the Vehicle Modeling & Simulation Analysis
@@ -19,7 +25,18 @@
  * definition in what the underlying libraries would support as multiple cases
  * within a larger simulation.
  * <P>
- * Usage:  "vmsat inputfilename"
+ * Given more than one input file, or a manifest listing input files, the
+ * cases are run as a batch within this process (see VmsatBatch), followed
+ * by a summary.  The exit status is then nonzero if any case failed.
+ * <P>
+ * With -d, vmsat instead runs as a server (see VmsatServer), answering
+ * requests read from standard input until it ends, or with -s, requests
+ * sent through connections to a Unix domain socket.
+ * <P>
+ * Usage:  "vmsat inputfilename [inputfilename ...]"
+ *         "vmsat -m manifestfilename"
+ *         "vmsat -d"
+ *         "vmsat -s socketfilename"
  * <P>
  * See supplemental documentation for input file syntax
  *
@@ -29,46 +46,73 @@
 int main(int argc, char* argv[])
 {
     // Check for filename
-  if (argc != 2) {
-    std::cerr << "\nProper use is:  " << argv[0] << " <in_file>\n";
+  std::string opt = (argc > 1) ? argv[1] : "";
+  if (argc < 2  ||  ((opt == "-m"  ||  opt == "-s")  &&  argc != 3)  ||
+                    (opt == "-d"  &&  argc != 2)) {
+    std::cerr << "\nProper use is:  " << argv[0] << " <in_file> [<in_file> ...]"
+              << "\n            or:  " << argv[0] << " -m <manifest>"
+              << "\n            or:  " << argv[0] << " -d"
+              << "\n            or:  " << argv[0] << " -s <socket>\n";
     return 0;
   }
 
+    // Server
+  if (opt == "-d") {
+    VmsatServer server;
+    server.serve(0, 1);
+    return 0;
+  } else if (opt == "-s") {
+    VmsatServer server;
+    try {
+      server.listen(argv[2]);
+    } catch (std::runtime_error& re) {
+    }
+    return 1;
+  }
+
+    // Many cases
+  if (argc > 2) {
+    std::vector<std::string> case_files;
+    try {
+      if (opt == "-m") {
+        case_files = VmsatBatch::read_manifest(argv[2]);
+      } else {
+        case_files.assign(argv + 1, argv + argc);
+      }
+    } catch (std::runtime_error& re) {
+      return 1;
+    }
+    VmsatBatch batch(case_files);
+    int nfailed = batch.run(std::cout);
+    batch.summary(std::cout);
+    return (nfailed > 0) ? 1 : 0;
+  }
+
     // Try to open for input
-  std::ifstream in_file(argv[1]);
+  MappedFile in_file(argv[1]);
   if (!in_file.is_open()) {
     std::cerr << "\nError opening " << argv[1] << "\n";
     return 0;
   }
 
-    // Ingest case file and close
-  VmsatCase vc{in_file};
+    // Ingest case file
+  VmsatCase vc{in_file.text()};
   if (!vc.is_valid()) {
-    char c;
-    int linenum = 1;
-    in_file.seekg(in_file.beg);
-    for (std::streamoff ii=0; ii<vc.err_start(); ++ii) {
-      in_file.get(c);
-      if (c == '\n') {
-        linenum++;
-      }
-    }
-    std::streamoff str_chunk_size = vc.err_stop() - vc.err_start();
-    in_file.seekg(vc.err_start());
-    std::cerr << "\nProblem on line " << linenum << ":  " << vc.err_token();
-    for (std::streamoff ii=0; ii<str_chunk_size; ++ii) {
-      in_file.get(c);
-      std::cerr << c;
-    }
-    std::cerr << "\n";
+    std::cerr << "\nProblem on line " << vc.err_line() << ", column " <<
+                 vc.err_column() << ":  " << vc.err_text() << "\n";
   }
-  in_file.close();
 
     // Output summary of input, run functions, and create reports
   if (vc.is_valid()) {
     vc.to_stream(std::cout);
-    vc.execute();
-    vc.report();
+    try {
+      vc.run();
+    } catch (std::exception& e) {
+      std::cout << "\n";
+      std::cout.flush();
+      std::cerr << "\nError running case:  " << e.what() << "\n";
+      return 1;
+    }
   }
 
   std::cout << "\n";
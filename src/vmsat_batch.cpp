@@ -0,0 +1,175 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <utl_thread_pool.h>
+#include <utl_mapped_file.h>
+#include <astro_table_cache.h>
+#include <vmsat_case.h>
+#include <vmsat_batch.h>
+
+VmsatBatch::VmsatBatch(const std::vector<std::string>& case_files,
+                       unsigned int nthreads) :
+                       files{case_files},
+                       pool{std::make_shared<ThreadPool>(nthreads)},
+                       tables{std::make_shared<AstroTableCache>()},
+                       results(case_files.size())
+{
+}
+
+
+std::vector<std::string> VmsatBatch::read_manifest(
+                                               const std::string& manifest)
+{
+  std::ifstream in_file(manifest);
+  if (!in_file.is_open()) {
+    std::cerr << "\nError opening " << manifest << '\n';
+    throw std::runtime_error("Can't open manifest " + manifest);
+  }
+  std::vector<std::string> names;
+  std::string line;
+  while (std::getline(in_file, line)) {
+    std::size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string::npos  ||  line[first] == '#') {
+      continue;
+    }
+    std::size_t last = line.find_last_not_of(" \t\r");
+    names.push_back(line.substr(first, last - first + 1));
+  }
+  return names;
+}
+
+
+/*
+ * One runner per pool thread claims cases in order.  Cases mostly wait
+ * on their functions, which run on the pool, so more runners than that
+ * would only add to the output held waiting for its turn.
+ */
+int VmsatBatch::run(std::ostream& out)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::atomic<std::size_t> next_case {0};
+  auto runner = [&]() {
+    for (;;) {
+      std::size_t ndx = next_case++;
+      if (ndx >= files.size()) {
+        break;
+      }
+      run_case(ndx);
+      std::lock_guard<std::mutex> lock(out_mtx);
+      results[ndx].done = true;
+      write_ready(out);
+    }
+  };
+
+  std::size_t nrunners = std::min(static_cast<std::size_t>(pool->size()),
+                                  files.size());
+  std::vector<std::thread> runners;
+  for (std::size_t ii=0; ii<nrunners; ++ii) {
+    runners.emplace_back(runner);
+  }
+  for (auto& thread : runners) {
+    thread.join();
+  }
+  batch_seconds = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start).count();
+
+  return static_cast<int>(std::count_if(results.begin(), results.end(),
+                                         [](const CaseResult& res) {
+                                           return !res.ok;
+                                         }));
+}
+
+
+/*
+ * As with a separate run of the case, output ends with a blank line and
+ * includes the partial reports of a case that fails while running.
+ */
+void VmsatBatch::run_case(std::size_t ndx)
+{
+  auto start = std::chrono::steady_clock::now();
+  CaseResult& res = results[ndx];
+  std::ostringstream text;
+  try {
+    MappedFile in_file(files[ndx]);
+    if (!in_file.is_open()) {
+      res.error = "Error opening " + files[ndx];
+    } else {
+      VmsatCase vc{in_file.text(), pool, tables};
+      if (!vc.is_valid()) {
+        res.error = "Problem on line " + std::to_string(vc.err_line()) +
+                    ", column " + std::to_string(vc.err_column()) + ":  " +
+                    vc.err_text();
+      } else {
+        vc.to_stream(text);
+        vc.run(text);
+        res.ok = true;
+      }
+    }
+  } catch (std::exception& e) {
+    res.error = e.what();
+  }
+  text << "\n";
+  if (!res.ok) {
+    std::cerr << '\n' << files[ndx] << ":  " << res.error << '\n';
+  }
+  res.output = text.str();
+  res.seconds = std::chrono::duration<double>(
+                  std::chrono::steady_clock::now() - start).count();
+}
+
+
+void VmsatBatch::write_ready(std::ostream& out)
+{
+  while (next_out < results.size()  &&  results[next_out].done) {
+    CaseResult& res = results[next_out];
+    out << "==> " << files[next_out] << " <==\n" << res.output;
+    out.flush();
+    std::string().swap(res.output);
+    ++next_out;
+  }
+}
+
+
+void VmsatBatch::summary(std::ostream& out) const
+{
+  std::size_t nfailed = std::count_if(results.begin(), results.end(),
+                                      [](const CaseResult& res) {
+                                        return !res.ok;
+                                      });
+  std::ostringstream text;
+  text << std::fixed << std::setprecision(3);
+  text << "\nBatch summary:  " << results.size() << " cases, " <<
+          nfailed << " failed, " << batch_seconds << " seconds\n";
+  for (std::size_t ii=0; ii<results.size(); ++ii) {
+    const CaseResult& res = results[ii];
+    text << (res.ok ? "  ok      " : "  FAILED  ") <<
+            std::setw(9) << res.seconds << " s  " << files[ii];
+    if (!res.ok) {
+      text << "  (" << res.error << ')';
+    }
+    text << '\n';
+  }
+  out << text.str();
+}
@@ -6,12 +6,31 @@
  * file, You can obtain one at http://mozilla.org/MPL/2.0/.
  */
 
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <memory_resource>
 #include <ostream>
+#include <fstream>
 #include <sstream>
+#include <string>
+#include <string_view>
+#include <iterator>
 #include <stdexcept>
+#include <exception>
+#include <functional>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 #include <vector>
 
+#include <unistd.h>
+
 #include <vmsat_case.h>
 #include <comp_ifunction.h>
 #include <comp_earth_rot.h>
@@ -19,107 +38,752 @@
 #include <utl_greg_date.h>
 #include <utl_time_of_day.h>
 #include <astro_julian_date.h>
+#include <astro_exact_time.h>
+#include <astro_leap_sec.h>
+#include <astro_ut1mutc.h>
+#include <astro_table_cache.h>
+#include <comp_time_grid.h>
+#include <comp_label_registry.h>
+#include <utl_thread_pool.h>
+#include <utl_io_stage.h>
+#include <comp_report_sink.h>
+#include <utl_spsc_queue.h>
+#include <utl_case_tokenizer.h>
+
+constexpr std::size_t VmsatCase::STREAM_DEPTH;
+constexpr std::size_t VmsatCase::STREAM_LINE_BYTES;
+constexpr std::size_t VmsatCase::STREAM_MIN_BUFSIZE;
+
+static std::unique_ptr<std::fstream> open_spool();
+static double parse_sim_days(const std::string& str);
+
+VmsatCase::VmsatCase(std::istream& is) :
+                            VmsatCase(std::string(
+                                        std::istreambuf_iterator<char>(is),
+                                        std::istreambuf_iterator<char>()))
+{
+}
+
+
+VmsatCase::VmsatCase(std::string_view text,
+                     const std::shared_ptr<ThreadPool>& workers,
+                     const std::shared_ptr<AstroTableCache>& tables) :
+                            pool{(workers != nullptr) ?
+                                 workers : std::make_shared<ThreadPool>()},
+                            table_cache{tables},
+                            grid_cache{
+                              std::make_shared<CompTimeGridCache>(&arena)}
+{
+  parse(text);
+  if (this->valid  &&  !sweeps.empty()) {
+    case_text = std::string(text);
+  }
+}
 
-static void reset_stream(std::istream&);
 
-VmsatCase::VmsatCase(std::istream& is)
+/*
+ * The variant's own values are applied once the whole case is parsed,
+ * overriding whatever the case text gives, wherever given.
+ */
+VmsatCase::VmsatCase(const VmsatCase& tmpl, std::size_t ndx) :
+                            pool{tmpl.pool},
+                            table_cache{tmpl.table_cache},
+                            grid_cache{
+                              std::make_shared<CompTimeGridCache>(&arena)},
+                            sweep_tmpl{&tmpl}
 {
-    // Record start of case description in stream for error feedback
-  this->case_pos0 = is.tellg();
-    // Read one token at a time skipping to EOL when encountering a
-    // comment.  Push the token into a vector buffer for processing of
-    // each major "input block"
+  parse(tmpl.case_text);
+  if (!this->valid) {
+    return;
+  }
+  std::vector<std::size_t> vals = tmpl.variant_values(ndx);
+  for (std::size_t ii=0; ii<vals.size(); ++ii) {
+    const SweepAxis& axis = tmpl.sweeps[ii];
+    const std::vector<std::string>& value = axis.values[vals[ii]];
+    switch (axis.param) {
+      case SweepParam::SIMSTART:
+        parse_keyword_block(CaseKeyWord::SIMSTART, value);
+        break;
+      case SweepParam::SIMDAYS:
+        parse_keyword_block(CaseKeyWord::SIMDAYS, value);
+        break;
+      case SweepParam::RATE:
+        comp_requests[axis.loc]->output_rate(std::stod(value[0]));
+    }
+  }
+  for (auto& comp : comp_requests) {
+    comp->file_suffix(variant_suffix(ndx));
+  }
+  if (tmpl.capture_bin) {
+    capture_binary();
+  }
+}
+
+
+void VmsatCase::parse(std::string_view text)
+{
+    // Tokens of each major "input block" are collected for processing
+    // once the block is closed
+  CaseTokenizer tokens(text);
   bool parsing_block {false};
   std::vector<std::string> input_block;
   CaseKeyWord kw_ndx = CaseKeyWord::NONE;
-  std::string token;
-  while (this->valid  &&  (is >> token)) {
-    if (token.front() == '#') {
-      // If this is a comment, read until EOL
-      char ch;
-      do {
-        if (!is.get(ch)) return;
-      } while (ch != '\n'  && ch != '\r');
-    } else if (/*{*/ token == "}" && parsing_block) {
+  std::string_view token;
+  while (this->valid  &&  tokens.next(token)) {
+    if (/*{*/ token == "}" && parsing_block) {
       // End of a block encountered - process
       try {
         this->parse_keyword_block(kw_ndx, input_block);
       } catch (std::invalid_argument &ia) {
-        reset_stream(is);
-        this->err_pos = is.tellg();
-        this->valid = false;
+        parse_error(tokens);
       }
       input_block.clear();
       parsing_block = false;
     } else if (!parsing_block) {
       // Expecting a keyword followed by an opening bracket
-      this->etoken = token;
+      this->err_ln = tokens.line();
+      this->err_col = tokens.column();
+      this->err_pos = tokens.offset();
       try {
-        this->err_pos0 = is.tellg();
-        kw_ndx = keyword_table.at(token);
-        std::string start_bracket;
-        is >> start_bracket;
-        if (start_bracket == "{" /*}*/) {
+        kw_ndx = keyword_table.at(std::string(token));
+        std::string_view start_bracket;
+        if (tokens.next(start_bracket)  &&  start_bracket == "{" /*}*/) {
           parsing_block = true;
         } else {
-          std::cerr << '\n' << "Expecting end bracket, not " << token << '\n';
-          reset_stream(is);
-          this->err_pos = is.tellg();
-          this->valid = false;
+          std::cerr << '\n' << "Expecting start bracket, not " <<
+                                start_bracket << '\n';
+          parse_error(tokens);
         }
       } catch(std::out_of_range &oor) {
         std::cerr << '\n' << "Not a keyword: " << token << '\n';
-        reset_stream(is);
-        this->err_pos = is.tellg();
-        this->valid = false;
+        parse_error(tokens);
       } catch (std::exception &e) {
-        reset_stream(is);
-        this->err_pos = is.tellg();
-        this->valid = false;
+        parse_error(tokens);
       }
-    } else if (parsing_block) {
-      // Add token to input block that will be evaluated based on keyword
-      input_block.push_back(token);
     } else {
-      reset_stream(is);
-      this->err_pos = is.tellg();
-      this->valid = false;
+      // Add token to input block that will be evaluated based on keyword
+      input_block.emplace_back(token);
     }
   }
-    // If the input block isn't empty, then the input stream ended before
-    // the last input block was ingested.
-  if (!input_block.empty()) {
-    std::cerr << '\n' << "Unexpected end of input stream: " << token << '\n';
-    reset_stream(is);
-    this->err_pos = is.tellg();
-    this->valid = false;
+    // If still within a block, then the input ended before the last
+    // input block was ingested.
+  if (this->valid  &&  parsing_block) {
+    std::cerr << '\n' << "Unexpected end of input stream\n";
+    parse_error(tokens);
   }
 }
 
+/*
+ * Functions are scheduled in dependency order - each becomes ready once
+ * the count of unfinished inputs drops to zero.  No more functions are
+ * submitted to the pool than it has workers, and the earliest defined
+ * ready function goes first.  Consumers are defined after their inputs,
+ * so they run as soon as their inputs are done, ahead of unrelated
+ * functions, letting inputs be retired early.  Shared time grids are
+ * released as soon as the last function using them is done.  Once its
+ * inputs are done, a function with a failed input is settled as failed
+ * without being run, and so on down the graph.  The calling thread waits
+ * until every function has been settled.
+ */
 void VmsatCase::execute()
 {
-  unsigned int nrpts = static_cast<unsigned int>(comp_requests.size());
-  for (unsigned int ii=0; ii<nrpts; ++ii) {
-    comp_requests[ii]->execute(*this);
+  execute(nullptr);
+}
+
+
+void VmsatCase::execute(const std::function<void(int, bool)>& on_done)
+{
+  int nrpts = static_cast<int>(comp_requests.size());
+  std::vector<bool> live = needed();
+  int nremaining = static_cast<int>(std::count(live.begin(), live.end(),
+                                               true));
+  if (nremaining == 0) {
+    return;
+  }
+  std::mutex mtx;
+  std::condition_variable done_cv;
+  std::exception_ptr first_error;
+  std::vector<int> nwaiting(nrpts);
+  for (int ii=0; ii<nrpts; ++ii) {
+    nwaiting[ii] = static_cast<int>(comp_requests[ii]->inputs().size());
+  }
+    // First failed input of each function, if any
+  std::vector<int> failed_input(nrpts, -1);
+    // Functions yet to finish with each grid step
+  std::map<std::int64_t, int> grid_users;
+  for (int ii=0; ii<nrpts; ++ii) {
+    std::int64_t step = comp_requests[ii]->grid_step();
+    if (live[ii]  &&  step != 0) {
+      ++grid_users[step];
+    }
+  }
+  std::set<int> ready;
+  int nrunning {0};
+  int max_running = static_cast<int>(pool->size());
+  std::function<void(int)> launch;
+
+    // Submit ready functions while workers are available - mtx held
+  auto dispatch = [&]() {
+    while (nrunning < max_running  &&  !ready.empty()) {
+      int ndx = *ready.begin();
+      ready.erase(ready.begin());
+      ++nrunning;
+      launch(ndx);
+    }
+  };
+
+    // Release the grid and dependents of a finished function, settling
+    // dependents of a failed one as failed in turn - mtx held
+  std::function<void(int, bool, std::vector<int>&)> settle;
+  settle = [&](int ndx, bool ok, std::vector<int>& not_run) {
+    std::int64_t step = comp_requests[ndx]->grid_step();
+    if (step != 0  &&  --grid_users[step] == 0) {
+      grid_cache->release(step);
+    }
+    for (int dep : comp_dependents[ndx]) {
+      if (!live[dep]) {
+        continue;
+      }
+      if (!ok  &&  failed_input[dep] < 0) {
+        failed_input[dep] = ndx;
+      }
+      if (--nwaiting[dep] == 0) {
+        if (failed_input[dep] < 0) {
+          ready.insert(dep);
+        } else {
+          not_run.push_back(dep);
+          settle(dep, false, not_run);
+        }
+      }
+    }
+  };
+
+    // Run a function, then release any dependents now free to run
+  launch = [&](int ndx) {
+    pool->submit([&, ndx]() {
+      bool ok {true};
+      try {
+        comp_requests[ndx]->execute(*this);
+      } catch (...) {
+        ok = false;
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!first_error) {
+          first_error = std::current_exception();
+        }
+      }
+      if (on_done) {
+        on_done(ndx, ok);
+      }
+      std::vector<int> not_run;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        settle(ndx, ok, not_run);
+        --nrunning;
+        dispatch();
+      }
+      for (int dep : not_run) {
+        const CompIFunction& comp = *comp_requests[dep];
+        std::cerr << "\nNot running " << comp.type_name() << " " <<
+                     comp.label() << ":  input " <<
+                     comp_requests[failed_input[dep]]->label() <<
+                     " failed\n";
+        if (on_done) {
+          on_done(dep, false);
+        }
+      }
+      std::lock_guard<std::mutex> lock(mtx);
+      nremaining -= 1 + static_cast<int>(not_run.size());
+      if (nremaining == 0) {
+        done_cv.notify_all();
+      }
+    });
+  };
+
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    for (int ii=0; ii<nrpts; ++ii) {
+      if (live[ii]  &&  nwaiting[ii] == 0) {
+        ready.insert(ii);
+      }
+    }
+    dispatch();
+    done_cv.wait(lock, [&nremaining] { return nremaining == 0; });
   }
-  /*
-  std::vector<std::unique_ptr<CompIFunction>>::iterator itr;
-  for (itr = comp_requests.begin(); itr !=  comp_requests.end(); ++ itr) {
-    (*itr)->execute(*this);
+  if (first_error) {
+    std::rethrow_exception(first_error);
   }
-  */
 }
 
 
-void VmsatCase::report()
+void VmsatCase::report(std::ostream& out)
 {
+  std::vector<bool> live = needed();
   unsigned int nrpts = static_cast<unsigned int>(comp_requests.size());
   for (unsigned int ii=0; ii<nrpts; ++ii) {
-    comp_requests[ii]->report(std::cout);
+    if (live[ii]) {
+      comp_requests[ii]->report(out);
+    }
+  }
+}
+
+
+/*
+ * The report thread waits on each function in turn.  Functions finishing
+ * out of order are simply picked up when their turn comes.  The I/O
+ * stage is destroyed last, after everything queued has been written.
+ */
+void VmsatCase::run(std::ostream& out)
+{
+  if (!sweeps.empty()) {
+    run_sweep(out);
+    return;
+  }
+  if (chunk_size > 0) {
+    bool all_stream {true};
+    for (const auto& comp : comp_requests) {
+      all_stream = all_stream  &&  comp->streams();
+    }
+    if (all_stream) {
+      stream(out);
+      return;
+    }
+    std::cerr << "\nNot all functions support streaming - running in memory\n";
+  }
+
+  enum class Status { PENDING, DONE, FAILED };
+  int nrpts = static_cast<int>(comp_requests.size());
+  std::vector<bool> live = needed();
+  IoStage io;
+  std::mutex mtx;
+  std::condition_variable done_cv;
+  std::vector<Status> status(nrpts, Status::PENDING);
+  std::exception_ptr report_error;
+    // Results are released once reported and no longer needed as input
+  std::vector<bool> reported(nrpts, false);
+  std::vector<int> nusers(nrpts);
+  for (int ii=0; ii<nrpts; ++ii) {
+    for (int dep : comp_dependents[ii]) {
+      nusers[ii] += live[dep] ? 1 : 0;
+    }
+  }
+
+  std::thread reporter([&]() {
+    try {
+      for (int ii=0; ii<nrpts; ++ii) {
+        if (!live[ii]) {
+          continue;
+        }
+        {
+          std::unique_lock<std::mutex> lock(mtx);
+          done_cv.wait(lock, [&] { return status[ii] != Status::PENDING; });
+          if (status[ii] == Status::FAILED) {
+            break;
+          }
+        }
+        comp_requests[ii]->report(out, &io);
+        bool unused {false};
+        {
+          std::lock_guard<std::mutex> lock(mtx);
+          reported[ii] = true;
+          unused = nusers[ii] == 0;
+        }
+        if (unused) {
+          comp_requests[ii]->release_results();
+        }
+      }
+    } catch (...) {
+      report_error = std::current_exception();
+    }
+  });
+
+  try {
+    execute([&](int ndx, bool ok) {
+      std::vector<int> unused;
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        status[ndx] = ok ? Status::DONE : Status::FAILED;
+        for (int input : comp_requests[ndx]->inputs()) {
+          if (--nusers[input] == 0  &&  reported[input]) {
+            unused.push_back(input);
+          }
+        }
+        done_cv.notify_all();
+      }
+      for (int input : unused) {
+        comp_requests[input]->release_results();
+      }
+    });
+  } catch (...) {
+    reporter.join();
+    throw;
+  }
+  reporter.join();
+  if (report_error) {
+    std::rethrow_exception(report_error);
+  }
+}
+
+
+/*
+ * Each function is a pipeline stage, run a step at a time as a task on
+ * the thread pool.  A step pops the next chunk from each input's queue,
+ * computes the stage's own chunk, hands it to each consumer's queue, and
+ * then writes it to the stage's sink.  A stage is ready for a step once
+ * every input has a chunk queued and every consumer has room, so no step
+ * ever waits.  Only the stage itself pops its inputs and pushes its
+ * outputs, so a stage found ready stays ready until it runs.  Chunks are
+ * shared, immutable once computed, and freed when the last consumer lets
+ * go.  A consumer that needs fewer chunks than an input produces closes
+ * its queues when done so the producer is not held up.
+ * <P>
+ * Stages are admitted in definition order, opening their sinks and any
+ * spool file, only while fewer than a window of admitted functions have
+ * text yet to reach the output stream.  The window is exceeded only if
+ * no admitted stage can make progress without a later one.  The text of
+ * each finished function is copied to the output stream once all before
+ * it have been.  On error, all queues are closed and no further steps
+ * are started.
+ */
+void VmsatCase::stream(std::ostream& out)
+{
+  typedef SpscQueue<std::shared_ptr<const CompSeries>> ChunkQueue;
+  enum class State { WAITING, IDLE, RUNNING, DONE };
+  int nrpts = static_cast<int>(comp_requests.size());
+  std::vector<bool> live = needed();
+  std::vector<std::size_t> nrecs(nrpts);
+  for (int ii=0; ii<nrpts; ++ii) {
+    if (live[ii]) {
+      nrecs[ii] = comp_requests[ii]->stream_begin(*this);
+    }
+  }
+
+    // One queue per dependency, held by the consumer in input order
+  std::vector<std::vector<std::unique_ptr<ChunkQueue>>> in_queues(nrpts);
+  std::vector<std::vector<ChunkQueue*>> out_queues(nrpts);
+  for (int ii=0; ii<nrpts; ++ii) {
+    if (!live[ii]) {
+      continue;
+    }
+    for (int input : comp_requests[ii]->inputs()) {
+      in_queues[ii].emplace_back(new ChunkQueue(STREAM_DEPTH));
+      out_queues[input].push_back(in_queues[ii].back().get());
+    }
+  }
+
+    // Functions sampling at the same rate share a chunk's grid only if
+    // they reach that chunk at about the same time, so only the most
+    // recent grids are worth keeping
+  grid_cache->limit(2*static_cast<std::size_t>(nrpts));
+
+    // Output buffers sized to hold about a chunk of text
+  IoStage io(IoStage::DEFAULT_DEPTH,
+             std::clamp(chunk_size*STREAM_LINE_BYTES,
+                        STREAM_MIN_BUFSIZE, IoStage::DEFAULT_BUFSIZE));
+  std::vector<std::unique_ptr<std::fstream>> spools(nrpts);
+  std::vector<std::unique_ptr<CompReportSink>> sinks(nrpts);
+
+  std::mutex mtx;
+  std::condition_variable done_cv;
+  std::exception_ptr first_error;
+  bool aborted {false};
+  std::vector<State> state(nrpts, State::WAITING);
+  std::vector<std::size_t> next_rec(nrpts);
+  int nremaining = static_cast<int>(std::count(live.begin(), live.end(),
+                                               true));
+  std::set<int> ready;
+  int nrunning {0};
+  int max_running = static_cast<int>(pool->size());
+  int next_admit {0};                       // Next function to admit
+  int next_out {0};                         // First with text not on out
+  int nopen {0};                            // Admitted, text not on out
+  int window = 2*max_running;
+  std::function<void(int)> update;
+
+    // Stop starting steps and release every stage - mtx held
+  auto fail = [&](std::exception_ptr err) {
+    if (!first_error) {
+      first_error = err;
+    }
+    aborted = true;
+    ready.clear();
+    for (auto& queues : in_queues) {
+      for (auto& queue : queues) {
+        queue->close();
+      }
+    }
+  };
+
+    // Copy text of finished functions to out, in order - mtx held
+  auto write_ready = [&]() {
+    while (!aborted  &&  next_out < nrpts  &&
+           (!live[next_out]  ||  state[next_out] == State::DONE)) {
+      if (spools[next_out] != nullptr) {
+        if (spools[next_out]->tellp() > 0) {
+          spools[next_out]->seekg(0);
+          out << spools[next_out]->rdbuf();
+        }
+        spools[next_out].reset();
+      }
+      if (live[next_out]) {
+        --nopen;
+      }
+      ++next_out;
+    }
+  };
+
+    // Close a stage's queues and sink, freeing its neighbors - mtx held
+  auto finish = [&](int ndx) {
+    state[ndx] = State::DONE;
+    --nremaining;
+    for (ChunkQueue* queue : out_queues[ndx]) {
+      queue->close();
+    }
+    for (auto& queue : in_queues[ndx]) {
+      queue->close();
+    }
+    sinks[ndx]->close();
+    sinks[ndx].reset();
+    write_ready();
+    for (int input : comp_requests[ndx]->inputs()) {
+      update(input);
+    }
+    for (int dep : comp_dependents[ndx]) {
+      if (live[dep]) {
+        update(dep);
+      }
+    }
+  };
+
+    // Mark an idle stage ready, or finish it if done - mtx held
+  update = [&](int ndx) {
+    if (aborted  ||  state[ndx] != State::IDLE) {
+      return;
+    }
+    if (next_rec[ndx] >= nrecs[ndx]) {
+      finish(ndx);
+      return;
+    }
+    bool have_inputs {true};
+    for (auto& queue : in_queues[ndx]) {
+      if (queue->size() == 0) {
+        if (queue->is_closed()) {
+          finish(ndx);
+          return;
+        }
+        have_inputs = false;
+      }
+    }
+    if (!have_inputs) {
+      return;
+    }
+    for (ChunkQueue* queue : out_queues[ndx]) {
+      if (!queue->is_closed()  &&  queue->size() == queue->capacity()) {
+        return;
+      }
+    }
+    ready.insert(ndx);
+  };
+
+    // Open the sink of the next function, spooling its text unless all
+    // before it are on out - mtx held
+  auto admit = [&]() {
+    while (next_admit < nrpts  &&  !live[next_admit]) {
+      ++next_admit;
+    }
+    if (next_admit == nrpts) {
+      return false;
+    }
+    int ndx = next_admit++;
+    std::ostream* text = &out;
+    if (ndx != next_out) {
+      spools[ndx] = open_spool();
+      text = spools[ndx].get();
+    }
+    sinks[ndx] = comp_requests[ndx]->report_begin(*text, &io);
+    state[ndx] = State::IDLE;
+    ++nopen;
+    update(ndx);
+    return true;
+  };
+
+  std::function<void(int)> launch;
+
+    // Admit functions within the window, beyond it only if otherwise
+    // stalled, and submit ready steps while workers are available - mtx
+    // held
+  auto dispatch = [&]() {
+    try {
+      while (!aborted  &&  nopen < window  &&  admit()) {
+      }
+      while (!aborted  &&  ready.empty()  &&  nrunning == 0  &&
+             nremaining > 0) {
+        if (!admit()) {
+          throw std::logic_error("Streaming pipeline stalled");
+        }
+      }
+    } catch (...) {
+      fail(std::current_exception());
+    }
+    while (nrunning < max_running  &&  !ready.empty()) {
+      int ndx = *ready.begin();
+      ready.erase(ready.begin());
+      state[ndx] = State::RUNNING;
+      ++nrunning;
+      launch(ndx);
+    }
+  };
+
+    // Run one step, then check the stage and its neighbors
+  launch = [&](int ndx) {
+    pool->submit([&, ndx]() {
+      std::exception_ptr err;
+      try {
+        const CompIFunction& comp = *comp_requests[ndx];
+        std::size_t ninputs = in_queues[ndx].size();
+        std::vector<std::shared_ptr<const CompSeries>> held(ninputs);
+        std::vector<CompSeriesView> in(ninputs);
+        for (std::size_t jj=0; jj<ninputs; ++jj) {
+          in_queues[ndx][jj]->try_pop(held[jj]);
+          in[jj] = held[jj]->view();
+        }
+        auto chunk = std::allocate_shared<CompSeries>(
+                       std::pmr::polymorphic_allocator<CompSeries>(&arena),
+                       &arena);
+        comp.stream_chunk(*this, next_rec[ndx], chunk_size, in, *chunk);
+        for (ChunkQueue* queue : out_queues[ndx]) {
+          if (!queue->is_closed()) {
+            std::shared_ptr<const CompSeries> shared {chunk};
+            queue->try_push(std::move(shared));
+          }
+        }
+        held.clear();
+        sinks[ndx]->write(chunk->view());
+      } catch (...) {
+        err = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(mtx);
+      --nrunning;
+      if (err) {
+        fail(err);
+      } else {
+        state[ndx] = State::IDLE;
+        next_rec[ndx] += chunk_size;
+        update(ndx);
+        for (int input : comp_requests[ndx]->inputs()) {
+          update(input);
+        }
+        for (int dep : comp_dependents[ndx]) {
+          if (live[dep]) {
+            update(dep);
+          }
+        }
+      }
+      dispatch();
+      if (nrunning == 0  &&  (nremaining == 0  ||  aborted)) {
+        done_cv.notify_all();
+      }
+    });
+  };
+
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    write_ready();
+    dispatch();
+    done_cv.wait(lock, [&] {
+      return nrunning == 0  &&  (nremaining == 0  ||  aborted);
+    });
+  }
+  grid_cache->limit(0);
+  grid_cache->clear();
+
+  for (auto& sink : sinks) {
+    if (sink != nullptr) {
+      sink->close();
+    }
+  }
+  if (first_error) {
+    std::rethrow_exception(first_error);
   }
 }
 
 
+/*
+ * As with a batch, one runner per pool thread claims variants in order,
+ * and output of variants finishing early is held until its turn.
+ */
+void VmsatCase::run_sweep(std::ostream& out)
+{
+  std::size_t nvar = num_variants();
+  std::vector<std::string> text(nvar);
+  std::vector<bool> done(nvar, false);
+  std::vector<std::exception_ptr> errors(nvar);
+  std::vector<std::vector<std::pair<std::string, std::string>>>
+                                                        var_bins(nvar);
+  std::mutex out_mtx;
+  std::size_t next_out {0};
+  std::atomic<std::size_t> next_var {0};
+  auto runner = [&]() {
+    for (;;) {
+      std::size_t ndx = next_var++;
+      if (ndx >= nvar) {
+        break;
+      }
+      std::ostringstream vout;
+      vout << "\nSweep variant " << ndx + 1 << " of " << nvar << ":  " <<
+              variant_str(ndx) << '\n';
+      try {
+        VmsatCase variant(*this, ndx);
+        if (!variant.is_valid()) {
+          throw std::runtime_error("Sweep variant failed to parse");
+        }
+        variant.to_stream(vout);
+        variant.run(vout);
+        var_bins[ndx] = variant.binary_output();
+      } catch (...) {
+        errors[ndx] = std::current_exception();
+      }
+      std::lock_guard<std::mutex> lock(out_mtx);
+      text[ndx] = vout.str();
+      done[ndx] = true;
+      while (next_out < nvar  &&  done[next_out]) {
+        out << text[next_out];
+        out.flush();
+        std::string().swap(text[next_out]);
+        ++next_out;
+      }
+    }
+  };
+
+  std::size_t nrunners = std::min(static_cast<std::size_t>(pool->size()),
+                                  nvar);
+  std::vector<std::thread> runners;
+  for (std::size_t ii=0; ii<nrunners; ++ii) {
+    runners.emplace_back(runner);
+  }
+  for (auto& thread : runners) {
+    thread.join();
+  }
+  for (auto& bins : var_bins) {
+    std::move(bins.begin(), bins.end(), std::back_inserter(bin_output));
+  }
+  for (const auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+
+std::size_t VmsatCase::num_variants() const
+{
+  std::size_t nvar {1};
+  for (const auto& axis : sweeps) {
+    nvar *= axis.values.size();
+  }
+  return nvar;
+}
+
+
 JulianDate VmsatCase::startJD() const
 {
   return sim_start_jd;
@@ -132,6 +796,34 @@ double VmsatCase::simDays() const
 }
 
 
+ThreadPool* VmsatCase::threadPool() const
+{
+  return pool.get();
+}
+
+
+const LeapSec& VmsatCase::leapSec() const
+{
+  return leap_sec;
+}
+
+
+const UT1mUTC& VmsatCase::ut1mUtc() const
+{
+  return ut1_utc;
+}
+
+
+std::shared_ptr<const CompTimeGrid> VmsatCase::timeGrid(
+                                                  const ExactTime& start,
+                                                  std::int64_t step_ns,
+                                                  std::size_t count) const
+{
+  return grid_cache->get(start, step_ns, count, leap_sec, ut1_utc,
+                         pool.get());
+}
+
+
 std::string VmsatCase::to_str()
 {
   char buf[128];
@@ -156,6 +848,22 @@ std::string VmsatCase::to_str()
   }
   ret_str.append("\n");
 
+    // Functions not worth running
+  std::vector<bool> live = needed();
+  for (std::size_t ii=0; ii<live.size(); ++ii) {
+    if (!live[ii]) {
+      ret_str.append("Skipping " + comp_requests[ii]->type_name() + " " +
+                     comp_requests[ii]->label() +
+                     ":  output not reported or used\n");
+    }
+  }
+
+    // Variants to be run in place of this case
+  if (!sweeps.empty()) {
+    ret_str.append("Sweeping " + std::to_string(num_variants()) +
+                   " variants\n");
+  }
+
   return ret_str;
 }
 
@@ -166,6 +874,44 @@ void VmsatCase::to_stream(std::ostream &out)
 }
 
 
+/*
+ * Buffers are allocated up front, one per function writing binary
+ * output.  Variants of a sweep capture their own, gathered once run.
+ */
+void VmsatCase::capture_binary()
+{
+  capture_bin = true;
+  if (!sweeps.empty()) {
+    return;
+  }
+  bin_output.clear();
+  for (const auto& comp : comp_requests) {
+    if (comp->report_binary()) {
+      bin_output.emplace_back(comp->file_name() + ".bin", "");
+    }
+  }
+  std::size_t nbin {0};
+  for (auto& comp : comp_requests) {
+    if (comp->report_binary()) {
+      comp->binary_buffer(&bin_output[nbin++].second);
+    }
+  }
+}
+
+
+std::vector<std::pair<std::string, std::string>>
+                                          VmsatCase::binary_output() const
+{
+  std::vector<std::pair<std::string, std::string>> written;
+  for (const auto& output : bin_output) {
+    if (!output.second.empty()) {
+      written.push_back(output);
+    }
+  }
+  return written;
+}
+
+
 void VmsatCase::parse_keyword_block(CaseKeyWord ndx,
                                     const std::vector<std::string>& inputs)
 {
@@ -179,14 +925,20 @@ void VmsatCase::parse_keyword_block(CaseKeyWord ndx,
           CompType cf_ndx = function_table.at(inputs[0]);
           switch (cf_ndx) {
             case CompType::EARTHROT:
-              comp_requests.emplace_back(new CompEarthRot(inputs));
+              comp_requests.emplace_back(new CompEarthRot(inputs, &arena));
+              add_to_graph();
               break;
             case CompType::RSS:
-              comp_requests.emplace_back(new CompRSS(inputs, comp_requests));
+              comp_requests.emplace_back(new CompRSS(inputs, comp_requests,
+                                                     comp_labels, &arena));
+              add_to_graph();
               break;
             case CompType::NONE:
               ;
           }
+          if (!comp_requests.empty()) {
+            comp_requests.back()->compression(compress);
+          }
         } catch(std::out_of_range& oor) {
           std::cerr << "\n" << "Not a COMPUTE Function: " << inputs[0] << "\n";
           throw;
@@ -206,30 +958,279 @@ void VmsatCase::parse_keyword_block(CaseKeyWord ndx,
       }
       break;
     case CaseKeyWord::SIMDAYS:
+      if (1 == static_cast<int>(inputs.size())) {
+        this->sim_days = parse_sim_days(inputs[0]);
+      } else {
+        throw std::invalid_argument("Wrong number of SIMDAYS parameters");
+      }
+      break;
+    case CaseKeyWord::LEAPSECFILE:
+      if (1 == static_cast<int>(inputs.size())) {
+        if (sweep_tmpl != nullptr) {
+          this->leap_sec = sweep_tmpl->leap_sec;
+        } else if (table_cache != nullptr) {
+          this->leap_sec = table_cache->leap_sec(inputs[0]);
+        } else {
+          this->leap_sec = LeapSec(inputs[0]);
+        }
+      } else {
+        throw std::invalid_argument("Wrong number of LEAPSECFILE parameters");
+      }
+      break;
+    case CaseKeyWord::EOPFILE:
+      if (1 == static_cast<int>(inputs.size())) {
+        if (sweep_tmpl != nullptr) {
+          this->ut1_utc = sweep_tmpl->ut1_utc;
+        } else if (table_cache != nullptr) {
+          this->ut1_utc = table_cache->ut1_utc(inputs[0]);
+        } else {
+          this->ut1_utc = UT1mUTC(inputs[0]);
+        }
+      } else {
+        throw std::invalid_argument("Wrong number of EOPFILE parameters");
+      }
+      break;
+    case CaseKeyWord::COMPRESS:
+      if (1 == static_cast<int>(inputs.size())  &&
+          (inputs[0] == "on"  ||  inputs[0] == "off")) {
+        this->compress = inputs[0] == "on";
+        for (auto& comp : comp_requests) {
+          comp->compression(compress);
+        }
+      } else {
+        std::cerr << "\n" << "Compress expects on or off" << "\n";
+        throw std::invalid_argument("Bad COMPRESS parameters");
+      }
+      break;
+    case CaseKeyWord::CHUNKSIZE:
       if (1 == static_cast<int>(inputs.size())) {
         std::istringstream iss(inputs[0]);
-        if (!(iss >> this->sim_days)) {
-          throw std::invalid_argument("Bad Duration");
+        long long nrec {0};
+        if (!(iss >> nrec)  ||  nrec < 0) {
+          throw std::invalid_argument("Bad chunk size");
         }
+        this->chunk_size = static_cast<std::size_t>(nrec);
       } else {
-        throw std::invalid_argument("Wrong number of SIMDAYS parameters");
+        throw std::invalid_argument("Wrong number of CHUNKSIZE parameters");
+      }
+      break;
+    case CaseKeyWord::SWEEP:
+      if (sweep_tmpl == nullptr) {
+        add_sweep(inputs);
       }
   }
 }
 
 
 /*
- * This should be called when there is an error parsing a value
- * from the stream so the end location of the error in the stream
- * can correctly be determined.  It should not be called when sucessfully
- * parsed data (say, a set of characters becomes an int) are logically
- * bad (say, trying to create Feb 31st).
+ * Values are checked here so a bad value is reported against the Sweep
+ * block rather than discovered while running variants.  A rate applies
+ * to the first function defined with the label, whether or not labeled
+ * for use as an input.
  */
-static void reset_stream(std::istream& bad_is)
+void VmsatCase::add_sweep(const std::vector<std::string>& inputs)
 {
-  bad_is.clear();
-  std::string bad_token;
-  if (!(bad_is >> bad_token)) {
-    bad_is.clear();
+  if (inputs.size() < 2) {
+    std::cerr << "\nSweep expects a parameter and values\n";
+    throw std::invalid_argument("Wrong number of SWEEP parameters");
+  }
+  SweepAxis axis;
+  if (inputs[0] == "SimStart") {
+    axis.param = SweepParam::SIMSTART;
+    if ((inputs.size() - 1) % 6 != 0) {
+      std::cerr << "\nSweep SimStart expects year month day hour " <<
+                   "minute second for each value\n";
+      throw std::invalid_argument("Wrong number of SWEEP parameters");
+    }
+    for (std::size_t ii=1; ii<inputs.size(); ii+=6) {
+      axis.values.emplace_back(inputs.begin() + ii, inputs.begin() + ii + 6);
+      const std::vector<std::string>& value = axis.values.back();
+      GregDate gd(value[0], value[1], value[2]);
+      TimeOfDay tod(value[3], value[4], value[5]);
+    }
+  } else if (inputs[0] == "SimDays") {
+    axis.param = SweepParam::SIMDAYS;
+    for (std::size_t ii=1; ii<inputs.size(); ++ii) {
+      parse_sim_days(inputs[ii]);
+      axis.values.push_back({inputs[ii]});
+    }
+  } else if (inputs[0] == "Rate") {
+    axis.param = SweepParam::RATE;
+    for (std::size_t ii=0; ii<comp_requests.size(); ++ii) {
+      if (comp_requests[ii]->label() == inputs[1]) {
+        axis.loc = static_cast<int>(ii);
+        break;
+      }
+    }
+    if (axis.loc < 0  ||  comp_requests[axis.loc]->output_rate() <= 0.0) {
+      std::cerr << "\nNo function with an output rate labeled " <<
+                   inputs[1] << '\n';
+      throw std::invalid_argument("Bad SWEEP function");
+    }
+    for (std::size_t ii=2; ii<inputs.size(); ++ii) {
+      std::istringstream iss(inputs[ii]);
+      double minutes {0.0};
+      if (!(iss >> minutes)  ||  ExactTime::ns_from_minutes(minutes) <= 0) {
+        std::cerr << "\nSweep Rate values must be positive\n";
+        throw std::invalid_argument("Bad SWEEP rate");
+      }
+      axis.values.push_back({inputs[ii]});
+    }
+  } else {
+    std::cerr << "\nSweep expects SimStart, SimDays, or Rate, not " <<
+                 inputs[0] << '\n';
+    throw std::invalid_argument("Bad SWEEP parameter");
+  }
+  if (axis.values.empty()) {
+    std::cerr << "\nSweep " << inputs[0] << " has no values\n";
+    throw std::invalid_argument("Wrong number of SWEEP parameters");
+  }
+  sweeps.push_back(std::move(axis));
+}
+
+
+std::string VmsatCase::variant_suffix(std::size_t ndx)
+{
+  return "_" + std::to_string(ndx + 1);
+}
+
+
+/*
+ * Variants are numbered as digits of a mixed radix number, with the last
+ * Sweep block as the least significant digit.
+ */
+std::vector<std::size_t> VmsatCase::variant_values(std::size_t ndx) const
+{
+  std::vector<std::size_t> vals(sweeps.size());
+  for (std::size_t ii=sweeps.size(); ii>0; --ii) {
+    std::size_t nvals = sweeps[ii-1].values.size();
+    vals[ii-1] = ndx % nvals;
+    ndx /= nvals;
+  }
+  return vals;
+}
+
+
+std::string VmsatCase::variant_str(std::size_t ndx) const
+{
+  std::vector<std::size_t> vals = variant_values(ndx);
+  std::string ret_str;
+  for (std::size_t ii=0; ii<vals.size(); ++ii) {
+    const SweepAxis& axis = sweeps[ii];
+    if (ii > 0) {
+      ret_str.append(", ");
+    }
+    switch (axis.param) {
+      case SweepParam::SIMSTART:
+        ret_str.append("SimStart");
+        break;
+      case SweepParam::SIMDAYS:
+        ret_str.append("SimDays");
+        break;
+      case SweepParam::RATE:
+        ret_str.append("Rate " + comp_requests[axis.loc]->label());
+    }
+    for (const auto& token : axis.values[vals[ii]]) {
+      ret_str.append(" " + token);
+    }
+  }
+  return ret_str;
+}
+
+
+/*
+ * Inputs are located by label during function creation, so they always
+ * precede the new function - the graph is acyclic by construction.
+ */
+void VmsatCase::add_to_graph()
+{
+  int loc = static_cast<int>(comp_requests.size()) - 1;
+  comp_dependents.emplace_back();
+  for (int input : comp_requests[loc]->inputs()) {
+    comp_dependents[input].push_back(loc);
+  }
+  if (comp_requests[loc]->report_label()) {
+    comp_labels.bind(comp_requests[loc]->label(), loc);
+  }
+}
+
+
+/*
+ * The text in error runs from the start of the current entry through the
+ * last token read.
+ */
+void VmsatCase::parse_error(const CaseTokenizer& tokens)
+{
+  this->valid = false;
+  this->err_str = std::string(tokens.text().substr(err_pos,
+                                                   tokens.end_offset() -
+                                                   err_pos));
+}
+
+
+/*
+ * Dependents are always defined after their inputs, so a single pass
+ * from last to first settles each function after all its dependents.
+ */
+std::vector<bool> VmsatCase::needed() const
+{
+  int nrpts = static_cast<int>(comp_requests.size());
+  std::vector<bool> live(nrpts, false);
+  for (int ii=nrpts-1; ii>=0; --ii) {
+    live[ii] = comp_requests[ii]->report_records();
+    for (int dep : comp_dependents[ii]) {
+      live[ii] = live[ii]  ||  live[dep];
+    }
+  }
+  return live;
+}
+
+
+/*
+ * Durations are converted to nanosecond counts when time axes are laid
+ * out, so must be positive and fit in an int64.
+ */
+static double parse_sim_days(const std::string& str)
+{
+  std::istringstream iss(str);
+  double days {0.0};
+  if (!(iss >> days)) {
+    throw std::invalid_argument("Bad Duration");
+  }
+  if (!(days > 0.0)  ||
+      days > static_cast<double>(ExactTime::MAX_DAYS)) {
+    std::cerr << "\nSimDays must be positive and at most " <<
+                 ExactTime::MAX_DAYS << '\n';
+    throw std::invalid_argument("Bad Duration");
+  }
+  return days;
+}
+
+
+/*
+ * Report text waiting for its turn on the output stream.  The file is
+ * unlinked once open so it vanishes however the program ends.
+ */
+static std::unique_ptr<std::fstream> open_spool()
+{
+  const char* tmpdir = std::getenv("TMPDIR");
+  std::string path = std::string((tmpdir != nullptr) ? tmpdir : "/tmp") +
+                     "/vmsatXXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  int fd = mkstemp(name.data());
+  if (fd < 0) {
+    std::cerr << "\nCan't create spool file in " << path << '\n';
+    throw std::runtime_error("Can't create report spool file");
+  }
+  std::unique_ptr<std::fstream> spool(new std::fstream(name.data(),
+                                          std::ios::in | std::ios::out |
+                                          std::ios::trunc | std::ios::binary));
+  close(fd);
+  unlink(name.data());
+  if (!*spool) {
+    std::cerr << "\nCan't open spool file " << name.data() << '\n';
+    throw std::runtime_error("Can't open report spool file");
   }
+  return spool;
 }
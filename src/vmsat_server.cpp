@@ -0,0 +1,282 @@
+/*
+ * Copyright 2016 Kurt Motekew
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cerrno>
+#include <csignal>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <utl_thread_pool.h>
+#include <astro_table_cache.h>
+#include <vmsat_case.h>
+#include <vmsat_server.h>
+
+/*
+ * Buffered reads of request lines and counted request bodies from a
+ * descriptor.
+ */
+namespace {
+  class FdReader {
+    public:
+      explicit FdReader(int fd) : in_fd{fd} {}
+
+      /**
+       * @param   str   Set to the next line, without its newline
+       *
+       * @return   False if the input ended before a complete line
+       */
+      bool line(std::string& str)
+      {
+        std::size_t eol;
+        while ((eol = buf.find('\n', pos)) == std::string::npos) {
+          if (!fill()) {
+            return false;
+          }
+        }
+        str.assign(buf, pos, eol - pos);
+        pos = eol + 1;
+        return true;
+      }
+
+      /**
+       * @param   nbytes   Number of bytes to read
+       * @param   str      Set to the bytes read
+       *
+       * @return   False if the input ended first
+       */
+      bool bytes(std::size_t nbytes, std::string& str)
+      {
+        while (buf.size() - pos < nbytes) {
+          if (!fill()) {
+            return false;
+          }
+        }
+        str.assign(buf, pos, nbytes);
+        pos += nbytes;
+        return true;
+      }
+
+    private:
+      int in_fd;
+      std::string buf;
+      std::size_t pos {0};                  // Next unread byte of buf
+
+      bool fill()
+      {
+        buf.erase(0, pos);
+        pos = 0;
+        char tmp[1 << 16];
+        ssize_t nread;
+        do {
+          nread = read(in_fd, tmp, sizeof(tmp));
+        } while (nread < 0  &&  errno == EINTR);
+        if (nread <= 0) {
+          return false;
+        }
+        buf.append(tmp, static_cast<std::size_t>(nread));
+        return true;
+      }
+  };
+}
+
+static bool write_all(int fd, std::string_view data);
+
+
+VmsatServer::VmsatServer(unsigned int nthreads) :
+                         pool{std::make_shared<ThreadPool>(nthreads)},
+                         tables{std::make_shared<AstroTableCache>()}
+{
+  std::signal(SIGPIPE, SIG_IGN);
+}
+
+
+std::size_t VmsatServer::serve(int in_fd, int out_fd)
+{
+  FdReader in(in_fd);
+  std::string line;
+  std::string text;
+  std::size_t nserved {0};
+  while (in.line(line)) {
+    std::istringstream iss(line);
+    std::string cmd;
+    if (!(iss >> cmd)) {
+      continue;
+    }
+    if (cmd == "Quit") {
+      break;
+    }
+    long long nbytes {-1};
+    std::string fmt {"text"};
+    std::string fmt_tok;
+    if (iss >> nbytes  &&  iss >> fmt_tok) {
+      fmt = fmt_tok;
+    }
+    if (cmd != "Case"  ||  nbytes < 0  ||
+                           (fmt != "text"  &&  fmt != "binary")) {
+      std::string msg = "Expecting Case <nbytes> [text|binary], not " +
+                        line + "\n";
+      write_all(out_fd, "Result bad 0 " + std::to_string(msg.size()) +
+                        " 0\n" + msg);
+      break;
+    }
+    if (!in.bytes(static_cast<std::size_t>(nbytes), text)) {
+      break;
+    }
+    if (!write_all(out_fd, evaluate(text, fmt == "binary"))) {
+      break;
+    }
+    ++nserved;
+  }
+  return nserved;
+}
+
+
+/*
+ * Finished sessions are joined as each new connection is accepted, so
+ * threads of past sessions don't accumulate.
+ */
+void VmsatServer::listen(const std::string& path)
+{
+  sockaddr_un addr {};
+  addr.sun_family = AF_UNIX;
+  if (path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "\nSocket path too long:  " << path << '\n';
+    throw std::runtime_error("Socket path too long");
+  }
+  path.copy(addr.sun_path, path.size());
+  int sfd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sfd < 0) {
+    std::cerr << "\nCan't create socket " << path << '\n';
+    throw std::runtime_error("Can't create socket");
+  }
+  unlink(path.c_str());
+  if (bind(sfd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0  ||
+      ::listen(sfd, SOMAXCONN) != 0) {
+    close(sfd);
+    std::cerr << "\nCan't listen on socket " << path << '\n';
+    throw std::runtime_error("Can't listen on socket");
+  }
+
+  struct Session {
+    std::thread thread;
+    std::atomic<bool> done {false};
+  };
+  std::list<Session> sessions;
+  for (;;) {
+    int cfd = accept(sfd, nullptr, nullptr);
+    if (cfd < 0) {
+      if (errno == EINTR  ||  errno == ECONNABORTED) {
+        continue;
+      }
+      break;
+    }
+    for (auto it = sessions.begin(); it != sessions.end();) {
+      if (it->done) {
+        it->thread.join();
+        it = sessions.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    sessions.emplace_back();
+    Session& session = sessions.back();
+    session.thread = std::thread([this, cfd, &session]() {
+      serve(cfd, cfd);
+      close(cfd);
+      session.done = true;
+    });
+  }
+  close(sfd);
+  for (auto& session : sessions) {
+    session.thread.join();
+  }
+  std::cerr << "\nStopped accepting connections on " << path << '\n';
+  throw std::runtime_error("Can't accept connections");
+}
+
+
+/*
+ * Output is formatted into memory so its length is known before any of
+ * it is sent.  Binary output is captured in memory as well, so nothing
+ * is written to or removed from the file system on its account.
+ */
+std::string VmsatServer::evaluate(std::string_view text, bool binary) const
+{
+  auto start = std::chrono::steady_clock::now();
+  std::ostringstream out;
+  std::string status {"ok"};
+  std::string body;
+  std::vector<std::pair<std::string, std::string>> bin_output;
+  try {
+    VmsatCase vc{text, pool, tables};
+    if (!vc.is_valid()) {
+      status = "invalid";
+      body = "Problem on line " + std::to_string(vc.err_line()) +
+             ", column " + std::to_string(vc.err_column()) + ":  " +
+             vc.err_text() + "\n";
+    } else {
+      if (binary) {
+        vc.capture_binary();
+      }
+      vc.to_stream(out);
+      vc.run(out);
+      out << "\n";
+      body = out.str();
+      bin_output = vc.binary_output();
+    }
+  } catch (std::exception& e) {
+    status = "failed";
+    body = std::string(e.what()) + "\n";
+  }
+
+  std::string files;
+  for (const auto& output : bin_output) {
+    files += "File " + output.first + " " +
+             std::to_string(output.second.size()) + "\n";
+    files += output.second;
+  }
+
+  long long usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                     std::chrono::steady_clock::now() - start).count();
+  return "Result " + status + " " + std::to_string(usec) + " " +
+         std::to_string(body.size()) + " " +
+         std::to_string(bin_output.size()) + "\n" +
+         body + files;
+}
+
+
+static bool write_all(int fd, std::string_view data)
+{
+  while (!data.empty()) {
+    ssize_t nwritten = write(fd, data.data(), data.size());
+    if (nwritten < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data.remove_prefix(static_cast<std::size_t>(nwritten));
+  }
+  return true;
+}